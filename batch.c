@@ -0,0 +1,504 @@
+#include "batch.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "console.h"
+#include "emu.h"
+#include "m68k.h"
+#include "mem.h"
+#include "ramdisk.h"
+
+
+
+#define BATCH_LINE_MAX 1024
+#define BATCH_MESSAGE_MAX 80
+
+/* Instructions executed between checks for a finished job. */
+#define BATCH_RUN_BUDGET 100000
+
+typedef enum {
+  BATCH_STATUS_PENDING,
+  BATCH_STATUS_DONE,  /* Script consumed, CP/M waits at the prompt. */
+  BATCH_STATUS_QUIT,  /* QUIT requested by CP/M. */
+  BATCH_STATUS_STOP,  /* STOP instruction, nothing will wake it up. */
+  BATCH_STATUS_PANIC, /* Would have entered the debugger. */
+  BATCH_STATUS_ERROR, /* Could not be started. */
+  BATCH_STATUS_TIMEOUT, /* Still running when its time was up. */
+} batch_status_t;
+
+static const char *batch_status_name[] = {
+  "pending",
+  "done",
+  "quit",
+  "stop",
+  "panic",
+  "error",
+  "timeout",
+};
+
+typedef struct batch_job_s {
+  char *output_filename;
+  char *script_filename;
+  char *ramdisk_filename[RAMDISK_MAX];
+  batch_status_t status;
+  char message[BATCH_MESSAGE_MAX];
+  uint64_t executed;
+  double seconds;
+  int worker;
+} batch_job_t;
+
+/* Jobs are dealt out to the workers up front. A worker takes its own jobs
+   from the head of its queue, and once that runs dry it steals from the
+   tail of the others, so a few long jobs do not hold up the short ones. */
+typedef struct batch_queue_s {
+  pthread_mutex_t mutex;
+  int *job;
+  int head;
+  int tail;
+} batch_queue_t;
+
+typedef struct batch_s {
+  const batch_config_t *config;
+  batch_job_t *job;
+  int job_n;
+  batch_queue_t *queue;
+  int queue_n;
+} batch_t;
+
+typedef struct batch_worker_s {
+  batch_t *batch;
+  int index;
+  pthread_t thread;
+} batch_worker_t;
+
+
+
+static double batch_seconds(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) +
+    ((now.tv_nsec - start->tv_nsec) / 1000000000.0);
+}
+
+
+
+static char *batch_strdup(const char *s)
+{
+  char *copy;
+
+  copy = malloc(strlen(s) + 1);
+  if (copy != NULL) {
+    strcpy(copy, s);
+  }
+  return copy;
+}
+
+
+
+static void batch_free(batch_t *batch)
+{
+  int i;
+  int j;
+
+  for (i = 0; i < batch->job_n; i++) {
+    free(batch->job[i].output_filename);
+    free(batch->job[i].script_filename);
+    for (j = 0; j < RAMDISK_MAX; j++) {
+      free(batch->job[i].ramdisk_filename[j]);
+    }
+  }
+  free(batch->job);
+
+  for (i = 0; i < batch->queue_n; i++) {
+    pthread_mutex_destroy(&batch->queue[i].mutex);
+    free(batch->queue[i].job);
+  }
+  free(batch->queue);
+}
+
+
+
+/* One job per line: OUTPUT SCRIPT [IMAGE-A [IMAGE-B [IMAGE-C [IMAGE-D]]]]
+   Disks left out, or given as '-', are taken from the command line.
+   A '#' starts a comment. */
+static int batch_manifest_load(batch_t *batch, const char *filename)
+{
+  FILE *fh;
+  char line[BATCH_LINE_MAX];
+  char *field[2 + RAMDISK_MAX];
+  char *save;
+  char *p;
+  batch_job_t *job;
+  int result;
+  int n;
+  int i;
+
+  fh = fopen(filename, "r");
+  if (fh == NULL) {
+    return -1;
+  }
+
+  result = 0;
+  while (result == 0 && fgets(line, sizeof(line), fh) != NULL) {
+    n = 0;
+    for (p = strtok_r(line, " \t\r\n", &save); p != NULL;
+      p = strtok_r(NULL, " \t\r\n", &save)) {
+      if (p[0] == '#') {
+        break;
+      }
+      if (n >= 2 + RAMDISK_MAX) {
+        n = -1; /* Too many fields. */
+        break;
+      }
+      field[n] = p;
+      n++;
+    }
+
+    if (n == 0) {
+      continue;
+    } else if (n < 2) {
+      result = -2;
+      break;
+    }
+
+    job = realloc(batch->job, (batch->job_n + 1) * sizeof(batch_job_t));
+    if (job == NULL) {
+      result = -3;
+      break;
+    }
+    batch->job = job;
+    job = &batch->job[batch->job_n];
+    memset(job, 0, sizeof(batch_job_t));
+    batch->job_n++;
+
+    job->output_filename = batch_strdup(field[0]);
+    job->script_filename = batch_strdup(field[1]);
+    if (job->output_filename == NULL || job->script_filename == NULL) {
+      result = -3;
+    }
+    for (i = 0; i < n - 2; i++) {
+      if (strcmp(field[2 + i], "-") != 0) {
+        job->ramdisk_filename[i] = batch_strdup(field[2 + i]);
+        if (job->ramdisk_filename[i] == NULL) {
+          result = -3;
+        }
+      }
+    }
+  }
+
+  if (ferror(fh)) {
+    result = -1;
+  }
+  fclose(fh);
+  return result;
+}
+
+
+
+static int batch_queue_init(batch_t *batch, int workers)
+{
+  int i;
+
+  batch->queue = calloc(workers, sizeof(batch_queue_t));
+  if (batch->queue == NULL) {
+    return -3;
+  }
+
+  for (i = 0; i < workers; i++) {
+    batch->queue[i].job = calloc(batch->job_n, sizeof(int));
+    if (batch->queue[i].job == NULL) {
+      return -3;
+    }
+    pthread_mutex_init(&batch->queue[i].mutex, NULL);
+    batch->queue_n++;
+  }
+
+  /* Round robin, so neighbouring manifest lines start out in parallel. */
+  for (i = 0; i < batch->job_n; i++) {
+    batch->queue[i % workers].job[batch->queue[i % workers].tail] = i;
+    batch->queue[i % workers].tail++;
+  }
+
+  return 0;
+}
+
+
+
+static int batch_queue_take(batch_queue_t *queue, bool steal)
+{
+  int job = -1;
+
+  pthread_mutex_lock(&queue->mutex);
+  if (queue->head < queue->tail) {
+    if (steal) {
+      queue->tail--;
+      job = queue->job[queue->tail];
+    } else {
+      job = queue->job[queue->head];
+      queue->head++;
+    }
+  }
+  pthread_mutex_unlock(&queue->mutex);
+
+  return job;
+}
+
+
+
+static int batch_job_setup(batch_t *batch, batch_job_t *job, emu_t *emu)
+{
+  const batch_config_t *config = batch->config;
+  const char *filename;
+  int i;
+
+  for (i = 0; i < RAMDISK_MAX; i++) {
+    filename = job->ramdisk_filename[i];
+    if (filename == NULL) {
+      filename = config->ramdisk_filename[i];
+    }
+    if (filename != NULL) {
+      if (ramdisk_load(&emu->ramdisk, i, filename) != 0) {
+        snprintf(job->message, BATCH_MESSAGE_MAX,
+          "Loading RAM disk %c file '%s' failed!", i + 0x41, filename);
+        return -1;
+      }
+    }
+  }
+
+  if (mem_load_srec(&emu->mem, config->cpm_bios_filename) != 0) {
+    snprintf(job->message, BATCH_MESSAGE_MAX,
+      "Loading CP/M and BIOS file '%s' failed!", config->cpm_bios_filename);
+    return -1;
+  }
+  emu->cpu.pc = config->cpm_bios_entry_point;
+  emu->cpu.chain = config->block_chain;
+
+  if (config->inject_filename != NULL) {
+    if (console_inject_file(&emu->console, config->inject_filename) != 0) {
+      snprintf(job->message, BATCH_MESSAGE_MAX,
+        "Injecting file '%s' failed!", config->inject_filename);
+      return -1;
+    }
+  }
+
+  if (config->inject_string != NULL) {
+    if (console_inject_string(&emu->console, config->inject_string) != 0) {
+      snprintf(job->message, BATCH_MESSAGE_MAX, "Injecting string failed!");
+      return -1;
+    }
+  }
+
+  if (console_inject_file(&emu->console, job->script_filename) != 0) {
+    snprintf(job->message, BATCH_MESSAGE_MAX,
+      "Injecting file '%s' failed!", job->script_filename);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+static void batch_job_run(batch_t *batch, batch_job_t *job)
+{
+  struct timespec start;
+  emu_t *emu;
+  FILE *output;
+  m68k_run_t result;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  job->status = BATCH_STATUS_ERROR;
+
+  output = fopen(job->output_filename, "wb");
+  if (output == NULL) {
+    snprintf(job->message, BATCH_MESSAGE_MAX,
+      "Opening output file '%s' failed!", job->output_filename);
+    return;
+  }
+
+  emu = emu_create(0);
+  if (emu == NULL) {
+    snprintf(job->message, BATCH_MESSAGE_MAX, "Creating emulator failed!");
+    fclose(output);
+    return;
+  }
+  emu->console.input = NULL;
+  emu->console.output = output;
+  emu->idle_break = true;
+  if (batch->config->timeout > 0) {
+    /* Also stop waiting for a script from a pipe or FIFO by then. */
+    emu->console.inject_deadline.tv_sec = start.tv_sec +
+      (time_t)batch->config->timeout;
+    emu->console.inject_deadline.tv_nsec = start.tv_nsec + (long)
+      ((batch->config->timeout - (time_t)batch->config->timeout) * 1e9);
+    if (emu->console.inject_deadline.tv_nsec >= 1000000000L) {
+      emu->console.inject_deadline.tv_sec++;
+      emu->console.inject_deadline.tv_nsec -= 1000000000L;
+    }
+  }
+
+  if (batch_job_setup(batch, job, emu) == 0) {
+    while (1) {
+      result = m68k_run(&emu->cpu, &emu->mem, BATCH_RUN_BUDGET);
+      if (emu->quit) {
+        job->status = BATCH_STATUS_QUIT;
+        break;
+      } else if (emu->console.inject_expired ||
+        (batch->config->timeout > 0 &&
+        batch_seconds(&start) >= batch->config->timeout)) {
+        job->status = BATCH_STATUS_TIMEOUT;
+        snprintf(job->message, BATCH_MESSAGE_MAX,
+          "Stopped at %06x after %g seconds.", emu->cpu.pc,
+          batch->config->timeout);
+        break;
+      } else if (emu->idle) {
+        job->status = BATCH_STATUS_DONE;
+        break;
+      } else if (emu->debugger_break) {
+        job->status = BATCH_STATUS_PANIC;
+        snprintf(job->message, BATCH_MESSAGE_MAX, "%s", emu->panic_msg);
+        job->message[strcspn(job->message, "\n")] = '\0';
+        break;
+      } else if (result == M68K_RUN_STOP) {
+        job->status = BATCH_STATUS_STOP;
+        break;
+      }
+    }
+  }
+
+  job->executed = emu->cpu.executed;
+  console_flush(&emu->console);
+  emu_destroy(emu);
+  if (fclose(output) != 0 && job->status != BATCH_STATUS_ERROR) {
+    job->status = BATCH_STATUS_ERROR;
+    snprintf(job->message, BATCH_MESSAGE_MAX,
+      "Writing output file '%s' failed!", job->output_filename);
+  }
+  job->seconds = batch_seconds(&start);
+}
+
+
+
+static void *batch_worker(void *arg)
+{
+  batch_worker_t *worker = arg;
+  batch_t *batch = worker->batch;
+  int job;
+  int i;
+
+  while (1) {
+    job = batch_queue_take(&batch->queue[worker->index], false);
+    for (i = 1; job < 0 && i < batch->queue_n; i++) {
+      job = batch_queue_take(
+        &batch->queue[(worker->index + i) % batch->queue_n], true);
+    }
+    if (job < 0) {
+      break; /* Jobs are only dealt out once, so all are taken. */
+    }
+    batch->job[job].worker = worker->index;
+    batch_job_run(batch, &batch->job[job]);
+  }
+
+  return NULL;
+}
+
+
+
+static int batch_report(batch_t *batch, double seconds)
+{
+  batch_job_t *job;
+  int failed = 0;
+  int i;
+
+  fprintf(stdout, " Job  Status   Instructions   Seconds  Worker  Output\n");
+  for (i = 0; i < batch->job_n; i++) {
+    job = &batch->job[i];
+    fprintf(stdout, "%4d  %-7s  %12llu  %8.3f  %6d  %s\n", i + 1,
+      batch_status_name[job->status], (unsigned long long)job->executed,
+      job->seconds, job->worker, job->output_filename);
+    if (job->message[0] != '\0') {
+      fprintf(stdout, "      %s\n", job->message);
+    }
+    if (job->status != BATCH_STATUS_DONE && job->status != BATCH_STATUS_QUIT) {
+      failed++;
+    }
+  }
+  fprintf(stdout, "%d jobs on %d workers in %.3f seconds, %d failed.\n",
+    batch->job_n, batch->queue_n, seconds, failed);
+
+  return failed;
+}
+
+
+
+int batch_run(const char *manifest_filename, const batch_config_t *config)
+{
+  struct timespec start;
+  batch_t batch;
+  batch_worker_t *worker;
+  int workers;
+  int result;
+  int i;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  memset(&batch, 0, sizeof(batch_t));
+  batch.config = config;
+
+  result = batch_manifest_load(&batch, manifest_filename);
+  if (result != 0) {
+    batch_free(&batch);
+    return result;
+  }
+
+  workers = config->workers;
+  if (workers <= 0) {
+    workers = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  if (workers > batch.job_n) {
+    workers = batch.job_n;
+  }
+  if (workers < 1) {
+    workers = 1;
+  }
+
+  worker = calloc(workers, sizeof(batch_worker_t));
+  if (worker == NULL || batch_queue_init(&batch, workers) != 0) {
+    free(worker);
+    batch_free(&batch);
+    return -3;
+  }
+
+  for (i = 0; i < workers; i++) {
+    worker[i].batch = &batch;
+    worker[i].index = i;
+    if (pthread_create(&worker[i].thread, NULL, batch_worker,
+      &worker[i]) != 0) {
+      break;
+    }
+  }
+
+  if (i == 0) {
+    result = -4;
+  } else {
+    /* Any workers that failed to start get their jobs stolen. */
+    while (i > 0) {
+      i--;
+      pthread_join(worker[i].thread, NULL);
+    }
+    result = batch_report(&batch, batch_seconds(&start));
+  }
+
+  free(worker);
+  batch_free(&batch);
+  return result;
+}
+
+
+
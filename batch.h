@@ -0,0 +1,23 @@
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ramdisk.h"
+
+#define BATCH_TIMEOUT_DEFAULT_S 60
+
+typedef struct batch_config_s {
+  const char *cpm_bios_filename;
+  uint32_t cpm_bios_entry_point;
+  const char *ramdisk_filename[RAMDISK_MAX]; /* For disks a job leaves out. */
+  const char *inject_filename; /* Injected ahead of every job script. */
+  const char *inject_string;
+  bool block_chain;
+  int workers; /* Zero for one per online host CPU. */
+  double timeout; /* Seconds a job may run, zero for no limit. */
+} batch_config_t;
+
+int batch_run(const char *manifest_filename, const batch_config_t *config);
+
+#endif /* _BATCH_H */
@@ -2,77 +2,302 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <termios.h>
 #include <unistd.h>
 #include "panic.h"
 
 
 
-#define CONSOLE_INJECT_MAX 65536
+/* Empty status polls in a row, without output in between, before CP/M is
+   considered waiting for input. Output makes the BDOS poll once per
+   character, looking for Ctrl+S. */
+#define CONSOLE_IDLE_POLLS 2
 
-/* NOTE: This pause hack is needed to prevent overflowing the CP/M key input
-   buffer which causes unpredictable results. Adjust if needed. */
-#define CONSOLE_INJECT_PAUSE 100
+/* Longest time output is held back in the buffer. */
+#define CONSOLE_FLUSH_INTERVAL_MS 20
 
-static uint8_t console_inject_buffer[CONSOLE_INJECT_MAX];
-static uint32_t console_inject_head = 0;
-static uint32_t console_inject_tail = 0;
-static uint32_t console_inject_pause = 0;
+#define CONSOLE_INPUT_MASK (CONSOLE_INPUT_MAX - 1)
 
-static int console_poll_timeout = 1;
+/* How often a sleeping console checks whether it has been cancelled. */
+#define CONSOLE_SLEEP_CHECK_MS 100
 
 
 
-uint8_t console_status(void)
+static bool console_input_ready(console_t *console)
 {
+  return atomic_load_explicit(&console->input_head, memory_order_acquire) !=
+    atomic_load_explicit(&console->input_tail, memory_order_relaxed) ||
+    atomic_load_explicit(&console->input_eof, memory_order_acquire);
+}
+
+
+
+/* Sleep until the input thread has something, for at most timeout
+   milliseconds, or for as long as it takes if negative. */
+static void console_input_wait(console_t *console, int timeout)
+{
+  struct timespec ts;
+
+  pthread_mutex_lock(&console->input_mutex);
+  if (timeout < 0) {
+    while (! console_input_ready(console)) {
+      pthread_cond_wait(&console->input_cond, &console->input_mutex);
+    }
+  } else if (timeout > 0 && ! console_input_ready(console)) {
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_nsec += timeout * 1000000L;
+    ts.tv_sec += ts.tv_nsec / 1000000000L;
+    ts.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(&console->input_cond, &console->input_mutex, &ts);
+  }
+  pthread_mutex_unlock(&console->input_mutex);
+}
+
+
+
+static void console_input_signal(console_t *console)
+{
+  pthread_mutex_lock(&console->input_mutex);
+  pthread_cond_signal(&console->input_cond);
+  pthread_mutex_unlock(&console->input_mutex);
+}
+
+
+
+static void *console_input_thread(void *arg)
+{
+  console_t *console = arg;
+  uint8_t buffer[CONSOLE_INPUT_MAX];
+  struct pollfd fds[2];
+  uint32_t head;
+  uint32_t space;
+  ssize_t n;
+  ssize_t i;
   int result;
+
+  fds[0].fd = console->input_wake[0];
+  fds[0].events = POLLIN;
+  fds[1].fd = fileno(console->input);
+  fds[1].events = POLLIN;
+
+  while (1) {
+    head = atomic_load_explicit(&console->input_head, memory_order_relaxed);
+    space = CONSOLE_INPUT_MAX - (head -
+      atomic_load_explicit(&console->input_tail, memory_order_acquire));
+
+    /* Leave input where it is while the ring is full, and check again. */
+    fds[1].revents = 0;
+    result = poll(fds, (space > 0) ? 2 : 1, (space > 0) ? -1 : 1);
+    if (result == -1 && errno != EINTR) {
+      break;
+    }
+    if (fds[0].revents != 0) {
+      break; /* Asked to stop. */
+    }
+    if (fds[1].revents == 0) {
+      continue;
+    }
+
+    n = read(fds[1].fd, buffer, space);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EINTR) {
+        continue;
+      }
+      n = 0; /* Treat as end of input. */
+    }
+
+    if (n == 0) {
+      atomic_store_explicit(&console->input_eof, true, memory_order_release);
+      console_input_signal(console);
+      break;
+    }
+
+    for (i = 0; i < n; i++) {
+      console->input_ring[(head + i) & CONSOLE_INPUT_MASK] = buffer[i];
+    }
+    atomic_store_explicit(&console->input_head, head + n,
+      memory_order_release);
+    console_input_signal(console);
+  }
+
+  return NULL;
+}
+
+
+
+static void console_inject_source_drop(console_t *console)
+{
+  if (console->inject_source[0].fd != -1) {
+    close(console->inject_source[0].fd);
+  }
+  console->inject_source_n--;
+  memmove(&console->inject_source[0], &console->inject_source[1],
+    console->inject_source_n * sizeof(console_source_t));
+}
+
+
+
+/* Milliseconds left to wait for a source, -1 for as long as it takes. */
+static int console_inject_time_left(console_t *console)
+{
+  struct timespec now;
+  long left;
+
+  if (console->inject_deadline.tv_sec == 0 &&
+    console->inject_deadline.tv_nsec == 0) {
+    return -1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  left = ((console->inject_deadline.tv_sec - now.tv_sec) * 1000) +
+    ((console->inject_deadline.tv_nsec - now.tv_nsec) / 1000000);
+  return (left > 0) ? left : 0;
+}
+
+
+
+/* Sources are only read once the inject buffer has run empty, so input
+   comes in as fast as CP/M takes it, and a writer to a pipe or FIFO is
+   held back until then. Reads block until there is more, or the end, or
+   until the inject deadline if one is set. */
+static void console_inject_refill(console_t *console)
+{
+  console_source_t *source;
   struct pollfd fds[1];
+  size_t len;
+  ssize_t n;
+  int left;
+
+  while (console->inject_source_n > 0 && ! console->inject_expired &&
+    console->inject_tail == console->inject_head) {
+    source = &console->inject_source[0];
+
+    if (source->fd == -1) {
+      len = strnlen(source->string, CONSOLE_INJECT_MAX - 1);
+      if (len == 0) {
+        console_inject_source_drop(console);
+        continue;
+      }
+      memcpy(console->inject_buffer, source->string, len);
+      source->string += len;
+      console->inject_tail = 0;
+      console->inject_head = len;
+      continue;
+    }
+
+    console_flush(console); /* The writer may be waiting for a prompt. */
+    fds[0].fd = source->fd;
+    fds[0].events = POLLIN;
+    left = console_inject_time_left(console);
+    if (poll(fds, 1, left) == 0) {
+      console->inject_expired = true;
+      return;
+    }
+    n = read(source->fd, console->inject_buffer, CONSOLE_INJECT_MAX - 1);
+    if (n < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      n = 0; /* Treat as end of input. */
+    }
+    if (n == 0) {
+      console_inject_source_drop(console);
+      continue;
+    }
+    console->inject_tail = 0;
+    console->inject_head = n;
+  }
+}
+
 
-  if (console_inject_tail != console_inject_head) {
-    if (console_inject_pause > 0) {
-      console_inject_pause--;
-      return 0x00; /* Wait (before getting more from inject buffer). */
-    } else {
-      console_inject_pause = CONSOLE_INJECT_PAUSE;
+
+uint8_t console_status(console_t *console)
+{
+  if (console->inject_source_n > 0) {
+    console_inject_refill(console);
+  }
+
+  /* Injected input is only handed out when polled again without output
+     in between, so when CP/M is blocked waiting for a key. The BDOS also
+     polls once after each character of output, looking for Ctrl+S, and
+     keys taken then overflow its small buffer and get lost. */
+  if (console->inject_tail != console->inject_head) {
+    if (console->idle_polls > 0) {
+      console->idle_polls = 0;
       return 0x01; /* Data available (from inject buffer). */
     }
+    console->idle_polls++;
+    return 0x00; /* Wait (before getting more from inject buffer). */
   }
 
-  fds[0].fd = STDIN_FILENO;
-  fds[0].events = POLLIN;
-  result = poll(fds, 1, console_poll_timeout); /* Relax host CPU if possible. */
-  if (result > 0) {
+  /* Polled again without output in between, so it waits for input. */
+  if (console->idle_polls > 0) {
+    console_flush(console);
+  }
+
+  if (console->input == NULL) {
+    console->idle_polls++;
+    return 0x00; /* Injected input only. */
+  }
+
+  /* Relax host CPU if possible, but only when it waits for input. */
+  if (console->idle_polls > 0 && ! console_input_ready(console)) {
+    console_input_wait(console, console->poll_timeout);
+  }
+
+  if (console_input_ready(console)) {
+    console->idle_polls = 0;
     return 0x01; /* Data available. */
-  } else if (result == -1) {
-    if (errno != EINTR) {
-      panic("poll() failed with errno: %d\n", errno);
-    }
   }
+  console->idle_polls++;
   return 0x00; /* No data. */
 }
 
 
 
-uint8_t console_read(void)
+uint8_t console_read(console_t *console)
 {
+  uint32_t tail;
   int c;
 
-  if (console_inject_tail != console_inject_head) {
-    c = console_inject_buffer[console_inject_tail];
-    console_inject_tail++;
-    if (console_inject_tail >= CONSOLE_INJECT_MAX) {
-      console_inject_tail = 0;
+  if (console->inject_source_n > 0) {
+    console_inject_refill(console);
+  }
+
+  if (console->inject_tail != console->inject_head) {
+    c = console->inject_buffer[console->inject_tail];
+    console->inject_tail++;
+    if (console->inject_tail >= CONSOLE_INJECT_MAX) {
+      console->inject_tail = 0;
     }
     return c;
   }
 
-  c = fgetc(stdin);
-  if (c == EOF) {
-    exit(EXIT_SUCCESS);
+  if (console->input == NULL) {
+    return 0x00; /* Not reached, the BIOS checks status first. */
+  }
+
+  console_flush(console); /* Someone is typing, show what came before. */
+  if (console->input_running) {
+    console_input_wait(console, -1);
+  }
+
+  tail = atomic_load_explicit(&console->input_tail, memory_order_relaxed);
+  if (tail == atomic_load_explicit(&console->input_head,
+    memory_order_acquire)) {
+    if (atomic_load_explicit(&console->input_eof, memory_order_acquire)) {
+      exit(EXIT_SUCCESS);
+    }
+    return 0x00; /* Not reached, the BIOS checks status first. */
   }
+  c = console->input_ring[tail & CONSOLE_INPUT_MASK];
+  atomic_store_explicit(&console->input_tail, tail + 1, memory_order_release);
 
   if (c == 0x7F) {
     c = 0x08; /* Convert DEL to BS for backspace to work correctly. */
@@ -87,61 +312,261 @@ uint8_t console_read(void)
 
 
 
-void console_write(uint8_t value)
+void console_write(console_t *console, uint8_t value)
 {
-  fputc(value, stdout);
+  console->idle_polls = 0;
+  if (console->output_n == 0) {
+    clock_gettime(CLOCK_MONOTONIC, &console->output_since);
+  }
+  console->output_buffer[console->output_n] = value;
+  console->output_n++;
+  if (console->output_n >= CONSOLE_OUTPUT_MAX) {
+    console_flush(console);
+  }
 }
 
 
 
-void console_inject(uint8_t value)
+void console_flush(console_t *console)
 {
-  console_inject_buffer[console_inject_head] = value;
-  console_inject_head++;
-  if (console_inject_head >= CONSOLE_INJECT_MAX) {
-    console_inject_head = 0;
+  if (console->output_n == 0) {
+    return;
   }
+  fwrite(console->output_buffer, 1, console->output_n, console->output);
+  fflush(console->output);
+  console->output_n = 0;
 }
 
 
 
-int console_inject_file(const char *filename)
+/* Called regularly from the run loop, in case the guest never waits. */
+void console_flush_timer(console_t *console)
 {
-  FILE *fh;
-  int c;
+  struct timespec now;
+
+  if (console->output_n == 0) {
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (((now.tv_sec - console->output_since.tv_sec) * 1000) +
+    ((now.tv_nsec - console->output_since.tv_nsec) / 1000000) >=
+    CONSOLE_FLUSH_INTERVAL_MS) {
+    console_flush(console);
+  }
+}
+
+
+
+/* Goes ahead of anything left in the sources, dropped if full. */
+void console_inject(console_t *console, uint8_t value)
+{
+  uint32_t head;
+
+  head = console->inject_head + 1;
+  if (head >= CONSOLE_INJECT_MAX) {
+    head = 0;
+  }
+  if (head == console->inject_tail) {
+    return;
+  }
+
+  console->idle_polls = 0;
+  console->inject_buffer[console->inject_head] = value;
+  console->inject_head = head;
+}
+
+
+
+/* Inject everything read from fd, a file, pipe or FIFO, after the sources
+   already added. The console closes fd, also on failure. */
+int console_inject_fd(console_t *console, int fd)
+{
+  if (console->inject_source_n >= CONSOLE_INJECT_SOURCES) {
+    close(fd);
+    return -3;
+  }
+
+  console->idle_polls = 0;
+  console->inject_source[console->inject_source_n].fd = fd;
+  console->inject_source[console->inject_source_n].string = NULL;
+  console->inject_source_n++;
+  return 0;
+}
+
+
+
+int console_inject_file(console_t *console, const char *filename)
+{
+  int fd;
 
   if (filename == NULL) {
     return -2;
   }
 
-  fh = fopen(filename, "r");
-  if (fh == NULL) {
+  /* A FIFO without a writer yet is not waited for here, but when read. */
+  fd = open(filename, O_RDONLY | O_NONBLOCK);
+  if (fd == -1) {
+    return -1;
+  }
+
+  return console_inject_fd(console, fd);
+}
+
+
+
+/* The string is not copied, and must stay until it has been consumed. */
+int console_inject_string(console_t *console, const char *string)
+{
+  if (console->inject_source_n >= CONSOLE_INJECT_SOURCES) {
+    return -3;
+  }
+
+  console->idle_polls = 0;
+  console->inject_source[console->inject_source_n].fd = -1;
+  console->inject_source[console->inject_source_n].string = string;
+  console->inject_source_n++;
+  return 0;
+}
+
+
+
+bool console_idle(console_t *console)
+{
+  return console->idle_polls >= CONSOLE_IDLE_POLLS;
+}
+
+
+
+/* Pending injected input is part of the machine state, but sources not
+   read yet are not. */
+int console_snapshot_save(console_t *console, FILE *fh)
+{
+  if (fwrite(&console->inject_head, sizeof(uint32_t), 1, fh) != 1 ||
+    fwrite(&console->inject_tail, sizeof(uint32_t), 1, fh) != 1 ||
+    fwrite(console->inject_buffer, CONSOLE_INJECT_MAX, 1, fh) != 1) {
     return -1;
   }
+  return 0;
+}
+
+
 
-  while ((c = fgetc(fh)) != EOF) {
-    console_inject(c);
+/* Nothing is changed unless all of it could be read. */
+int console_snapshot_load(console_t *console, FILE *fh)
+{
+  uint32_t head;
+  uint32_t tail;
+  uint8_t *buffer;
+
+  buffer = malloc(CONSOLE_INJECT_MAX);
+  if (buffer == NULL) {
+    return -1;
+  }
+  if (fread(&head, sizeof(uint32_t), 1, fh) != 1 ||
+    fread(&tail, sizeof(uint32_t), 1, fh) != 1 ||
+    fread(buffer, CONSOLE_INJECT_MAX, 1, fh) != 1) {
+    free(buffer);
+    return -1;
+  }
+  if (head >= CONSOLE_INJECT_MAX || tail >= CONSOLE_INJECT_MAX) {
+    free(buffer);
+    return -2;
   }
 
-  fclose(fh);
+  memcpy(console->inject_buffer, buffer, CONSOLE_INJECT_MAX);
+  free(buffer);
+  console->inject_head = head;
+  console->inject_tail = tail;
+  console->idle_polls = 0;
   return 0;
 }
 
 
 
-bool console_warp_mode_toggle(void)
+bool console_warp_mode_toggle(console_t *console)
 {
-  if (console_poll_timeout == 0) {
-    console_poll_timeout = 1;
+  if (console->poll_timeout == 0) {
+    console->poll_timeout = 1;
     return false; /* Warp mode disabled. */
   } else {
-    console_poll_timeout = 0;
+    console->poll_timeout = 0;
     return true; /* Warp mode enabled. */
   }
 }
 
 
 
+int console_input_start(console_t *console)
+{
+  sigset_t mask;
+  sigset_t old_mask;
+  int result;
+
+  if (console->input == NULL || console->input_running) {
+    return 0;
+  }
+
+  if (console->input_wake[0] == -1) {
+    if (pipe(console->input_wake) != 0) {
+      console->input_wake[0] = -1;
+      console->input_wake[1] = -1;
+      return -1;
+    }
+  }
+
+  /* Signals like SIGINT should interrupt the emulator, not this thread. */
+  sigfillset(&mask);
+  pthread_sigmask(SIG_SETMASK, &mask, &old_mask);
+  result = pthread_create(&console->input_thread, NULL,
+    console_input_thread, console);
+  pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+  if (result != 0) {
+    return -2;
+  }
+
+  console->input_running = true;
+  return 0;
+}
+
+
+
+/* Block until there is input, or cancel is set by a signal handler. */
+void console_input_sleep(console_t *console, const bool *cancel)
+{
+  if (! console->input_running) {
+    return; /* Nothing would wake it up. */
+  }
+
+  while (! *cancel && console->inject_tail == console->inject_head &&
+    ! console_input_ready(console)) {
+    console_input_wait(console, CONSOLE_SLEEP_CHECK_MS);
+  }
+}
+
+
+
+/* Stopped while something else, like the debugger, reads from the input. */
+void console_input_stop(console_t *console)
+{
+  uint8_t byte = 0;
+
+  if (! console->input_running) {
+    return;
+  }
+
+  if (write(console->input_wake[1], &byte, 1) == 1) {
+    pthread_join(console->input_thread, NULL);
+    if (read(console->input_wake[0], &byte, 1) != 1) {
+      panic(console->context, "Console input thread did not stop!\n");
+    }
+  } else {
+    panic(console->context, "Console input thread could not be stopped!\n");
+  }
+  console->input_running = false;
+}
+
+
+
 void console_pause(void)
 {
   struct termios ts;
@@ -180,12 +605,61 @@ void console_resume(void)
 
 
 
-void console_init(void)
+void console_init(console_t *console)
+{
+  pthread_condattr_t attr;
+
+  console->input = stdin;
+  console->output = stdout;
+  console->context = NULL;
+  console->inject_head = 0;
+  console->inject_tail = 0;
+  console->inject_source_n = 0;
+  console->inject_deadline.tv_sec = 0;
+  console->inject_deadline.tv_nsec = 0;
+  console->inject_expired = false;
+  console->idle_polls = 0;
+  console->poll_timeout = 1;
+  console->output_n = 0;
+
+  atomic_init(&console->input_head, 0);
+  atomic_init(&console->input_tail, 0);
+  atomic_init(&console->input_eof, false);
+  console->input_running = false;
+  console->input_wake[0] = -1;
+  console->input_wake[1] = -1;
+  pthread_mutex_init(&console->input_mutex, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&console->input_cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+
+
+void console_free(console_t *console)
+{
+  console_input_stop(console);
+  while (console->inject_source_n > 0) {
+    console_inject_source_drop(console);
+  }
+  if (console->input_wake[0] != -1) {
+    close(console->input_wake[0]);
+    close(console->input_wake[1]);
+  }
+  pthread_cond_destroy(&console->input_cond);
+  pthread_mutex_destroy(&console->input_mutex);
+}
+
+
+
+/* The terminal is shared by the whole process. */
+void console_terminal_init(void)
 {
   atexit(console_pause);
   console_resume();
 
-  /* Make stdout unbuffered. */
+  /* Make stdout unbuffered, console output is buffered per console. */
   setvbuf(stdout, NULL, _IONBF, 0);
 }
 
@@ -1,18 +1,75 @@
 #ifndef _CONSOLE_H
 #define _CONSOLE_H
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <time.h>
 
-uint8_t console_status(void);
-uint8_t console_read(void);
-void console_write(uint8_t value);
+#define CONSOLE_INJECT_MAX 65536
+#define CONSOLE_OUTPUT_MAX 4096
+#define CONSOLE_INPUT_MAX 4096 /* Must be a power of two. */
+#define CONSOLE_INJECT_SOURCES 8
 
-bool console_warp_mode_toggle(void);
-void console_inject(uint8_t value);
-int console_inject_file(const char *filename);
+/* Injected input still to be read, from a file descriptor or a string. */
+typedef struct console_source_s {
+  int fd; /* -1 for a string. */
+  const char *string;
+} console_source_t;
+
+typedef struct console_s {
+  FILE *input; /* NULL for injected input only. */
+  FILE *output;
+  void *context; /* Passed to panic(). */
+  uint8_t inject_buffer[CONSOLE_INJECT_MAX];
+  uint32_t inject_head;
+  uint32_t inject_tail;
+  console_source_t inject_source[CONSOLE_INJECT_SOURCES]; /* In turn. */
+  int inject_source_n;
+  struct timespec inject_deadline; /* Reads of sources give up, or zero. */
+  bool inject_expired; /* Deadline passed while waiting for a source. */
+  uint32_t idle_polls;
+  int poll_timeout;
+  uint8_t output_buffer[CONSOLE_OUTPUT_MAX];
+  uint32_t output_n;
+  struct timespec output_since; /* When the buffer got its first byte. */
+
+  /* Keys read by the input thread, the only producer, and taken by the
+     emulator, the only consumer, without locks or system calls. */
+  uint8_t input_ring[CONSOLE_INPUT_MAX];
+  atomic_uint input_head;
+  atomic_uint input_tail;
+  atomic_bool input_eof;
+  bool input_running;
+  pthread_t input_thread;
+  int input_wake[2]; /* Pipe telling the input thread to stop. */
+  pthread_mutex_t input_mutex; /* Only for sleeping until input arrives. */
+  pthread_cond_t input_cond;
+} console_t;
+
+uint8_t console_status(console_t *console);
+uint8_t console_read(console_t *console);
+void console_write(console_t *console, uint8_t value);
+void console_flush(console_t *console);
+void console_flush_timer(console_t *console);
+bool console_idle(console_t *console);
+
+bool console_warp_mode_toggle(console_t *console);
+void console_inject(console_t *console, uint8_t value);
+int console_inject_fd(console_t *console, int fd);
+int console_inject_file(console_t *console, const char *filename);
+int console_inject_string(console_t *console, const char *string);
+int console_input_start(console_t *console);
+void console_input_stop(console_t *console);
+void console_input_sleep(console_t *console, const bool *cancel);
+int console_snapshot_save(console_t *console, FILE *fh);
+int console_snapshot_load(console_t *console, FILE *fh);
 void console_pause(void);
 void console_resume(void);
-void console_init(void);
+void console_init(console_t *console);
+void console_free(console_t *console);
+void console_terminal_init(void);
 
 #endif /* _CONSOLE_H */
@@ -0,0 +1,322 @@
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "m68k.h"
+#include "mem.h"
+
+
+
+/* Runs the same instruction tests on whichever CPU core it is built with
+   and prints the resulting machine state, so the outputs of two builds,
+   like the loop and the threaded core, can be compared. */
+
+#define CPUCHECK_PROGRAM 0x400
+#define CPUCHECK_RANDOM_END 0x20000
+#define CPUCHECK_SEEDS 100
+#define CPUCHECK_STEPS 20000
+#define CPUCHECK_CHUNKS 200
+#define CPUCHECK_CHUNK_BUDGET 100
+
+#define CPUCHECK_BENCH_INSTRUCTIONS 200000000
+#define CPUCHECK_BENCH_BUDGET 100000
+
+static mem_t mem;
+static m68k_t cpu;
+static uint64_t cpucheck_seed;
+
+
+
+static uint32_t cpucheck_random(void)
+{
+  cpucheck_seed ^= cpucheck_seed << 13;
+  cpucheck_seed ^= cpucheck_seed >> 7;
+  cpucheck_seed ^= cpucheck_seed << 17;
+  return cpucheck_seed >> 11;
+}
+
+
+
+void panic(void *context, const char *format, ...)
+{
+  va_list args;
+
+  (void)context;
+  va_start(args, format);
+  fprintf(stdout, "Panic: ");
+  vfprintf(stdout, format, args);
+  va_end(args);
+  cpu.stop = M68K_RUN_PANIC;
+}
+
+
+
+static bool cpucheck_trap_hook(void *context, uint32_t d[8])
+{
+  (void)context;
+  d[0] ^= d[1];
+  return false;
+}
+
+
+
+static void cpucheck_dump(void)
+{
+  int i;
+
+  m68k_cc_flush(&cpu);
+  fprintf(stdout, "%06x", cpu.pc);
+  for (i = 0; i < 8; i++) {
+    fprintf(stdout, " %x", cpu.d[i]);
+  }
+  for (i = 0; i < 8; i++) {
+    fprintf(stdout, " %x", cpu.a[i]);
+  }
+  fprintf(stdout, " %x %04x\n", cpu.ssp, cpu.sr);
+}
+
+
+
+static void cpucheck_dump_mem(void)
+{
+  uint32_t hash = 2166136261U; /* FNV-1a */
+  uint32_t i;
+
+  for (i = 0; i < MEM_MAX; i++) {
+    hash ^= mem_read_byte(&mem, i);
+    hash *= 16777619U;
+  }
+  fprintf(stdout, "mem %08x\n", hash);
+}
+
+
+
+/* Memory and cached blocks are kept unless filled, starting over for
+   every opcode in the sweep takes too long. */
+static void cpucheck_setup(uint64_t seed, bool fill, bool chain)
+{
+  bool error = false;
+  uint32_t i;
+
+  cpucheck_seed = (seed * 2654435761U) + 1;
+  if (fill) {
+    mem_init(&mem);
+    for (i = CPUCHECK_PROGRAM; i < CPUCHECK_RANDOM_END; i += 2) {
+      mem_write_word(&mem, i, cpucheck_random() & 0xFFFF, &error);
+    }
+  }
+
+  /* Every exception vector leads somewhere into the program. */
+  for (i = 0; i < 256; i++) {
+    mem_write_long(&mem, i * 4, CPUCHECK_PROGRAM +
+      ((cpucheck_random() % 0xF000) & ~1), &error);
+  }
+
+  if (fill) {
+    m68k_free(&cpu);
+    m68k_init(&cpu);
+  }
+  cpu.trap_15_hook = cpucheck_trap_hook;
+  cpu.chain = chain;
+
+  for (i = 0; i < 8; i++) {
+    cpu.d[i] = cpucheck_random();
+    if (cpucheck_random() & 1) {
+      cpu.d[i] &= 0xFF;
+    }
+    cpu.a[i] = 0x20000 + (cpucheck_random() % 0x10000);
+  }
+  for (i = 0; i < 4; i++) {
+    if (cpucheck_random() & 1) {
+      cpu.a[i] |= 1; /* Provoke address errors. */
+    }
+  }
+  cpu.ssp = 0x80000;
+  cpu.a[7] = 0x70000;
+  cpu.pc = CPUCHECK_PROGRAM;
+  cpu.sr = (cpucheck_random() & 0x1F) |
+    ((cpucheck_random() & 1) ? 0x2000 : 0);
+}
+
+
+
+/* Random programs wander off, bring them back. */
+static void cpucheck_pc_check(void)
+{
+  if (cpu.pc > 0xFFFFFF) {
+    cpu.pc = CPUCHECK_PROGRAM + ((cpucheck_random() % 0xF000) & ~1);
+  }
+}
+
+
+
+/* Every opcode once, with random extension words. */
+static void cpucheck_sweep(void)
+{
+  bool error = false;
+  uint32_t opcode;
+  int i;
+
+  mem_init(&mem);
+  for (opcode = 0; opcode < 0x10000; opcode++) {
+    cpucheck_setup(opcode, false, false);
+    mem_write_word(&mem, CPUCHECK_PROGRAM, opcode, &error);
+    for (i = 1; i < 6; i++) {
+      mem_write_word(&mem, CPUCHECK_PROGRAM + (i * 2),
+        cpucheck_random() & 0xFFFF, &error);
+    }
+    fprintf(stdout, "%04x ", opcode);
+    m68k_run(&cpu, &mem, 1);
+    cpucheck_dump();
+  }
+}
+
+
+
+/* Random programs, one instruction at a time. */
+static void cpucheck_step(void)
+{
+  int seed;
+  int i;
+
+  for (seed = 0; seed < CPUCHECK_SEEDS; seed++) {
+    cpucheck_setup(seed + 1000, true, false);
+    for (i = 0; i < CPUCHECK_STEPS; i++) {
+      m68k_run(&cpu, &mem, 1);
+      cpucheck_pc_check();
+    }
+    cpucheck_dump();
+    cpucheck_dump_mem();
+  }
+}
+
+
+
+/* Random programs in longer runs, so cached blocks are used, chained or
+   not, and are invalidated by the programs overwriting themselves. */
+static void cpucheck_chunk(bool chain)
+{
+  int seed;
+  int i;
+
+  for (seed = 0; seed < CPUCHECK_SEEDS; seed++) {
+    cpucheck_setup(seed + 5000, true, chain);
+    for (i = 0; i < CPUCHECK_CHUNKS; i++) {
+      m68k_run(&cpu, &mem, CPUCHECK_CHUNK_BUDGET);
+      cpucheck_pc_check();
+    }
+    cpucheck_dump();
+    cpucheck_dump_mem();
+  }
+}
+
+
+
+/* A copy and checksum loop over 4000 bytes, restarted forever. */
+static const uint16_t cpucheck_bench_program[] = {
+  0x41F9, 0x0001, 0x0000, /* LEA $10000, A0 */
+  0x43F9, 0x0002, 0x0000, /* LEA $20000, A1 */
+  0x343C, 0x03E7,         /* MOVE.W #999, D2 */
+  0x2218,                 /* MOVE.L (A0)+, D1 */
+  0xD081,                 /* ADD.L D1, D0 */
+  0xB181,                 /* EOR.L D0, D1 */
+  0x22C1,                 /* MOVE.L D1, (A1)+ */
+  0x51CA, 0xFFF6,         /* DBRA D2, $410 */
+  0x60E2,                 /* BRA $400 */
+};
+
+static void cpucheck_bench(bool chain)
+{
+  struct timespec start;
+  struct timespec end;
+  bool error = false;
+  uint64_t executed = 0;
+  double seconds;
+  uint32_t i;
+
+  cpucheck_setup(0, false, chain);
+  for (i = 0; i < sizeof(cpucheck_bench_program) / sizeof(uint16_t); i++) {
+    mem_write_word(&mem, CPUCHECK_PROGRAM + (i * 2),
+      cpucheck_bench_program[i], &error);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (executed < CPUCHECK_BENCH_INSTRUCTIONS) {
+    if (m68k_run(&cpu, &mem, CPUCHECK_BENCH_BUDGET) != M68K_RUN_BUDGET) {
+      fprintf(stdout, "Benchmark stopped at %06x!\n", cpu.pc);
+      return;
+    }
+    executed += CPUCHECK_BENCH_BUDGET;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  seconds = (end.tv_sec - start.tv_sec) +
+    ((end.tv_nsec - start.tv_nsec) / 1000000000.0);
+  fprintf(stdout, "%llu instructions in %.3f seconds, %.1f MIPS\n",
+    (unsigned long long)executed, seconds, executed / seconds / 1000000.0);
+}
+
+
+
+static void display_help(const char *progname)
+{
+  fprintf(stdout, "Usage: %s <options>\n", progname);
+  fprintf(stdout, "Options:\n"
+    "  -h        Display this help.\n"
+    "  -b        Run the benchmark loop instead of the tests.\n"
+    "  -j        Chain cached blocks in the benchmark.\n"
+    "\n");
+}
+
+
+
+int main(int argc, char *argv[])
+{
+  int c;
+  bool bench = false;
+  bool chain = false;
+
+  while ((c = getopt(argc, argv, "hbj")) != -1) {
+    switch (c) {
+    case 'h':
+      display_help(argv[0]);
+      return EXIT_SUCCESS;
+
+    case 'b':
+      bench = true;
+      break;
+
+    case 'j':
+      chain = true;
+      break;
+
+    case '?':
+    default:
+      display_help(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (m68k_init(&cpu) != 0) {
+    fprintf(stdout, "Initializing CPU failed!\n");
+    return EXIT_FAILURE;
+  }
+
+  if (bench) {
+    cpucheck_bench(chain);
+  } else {
+    cpucheck_sweep();
+    cpucheck_step();
+    cpucheck_chunk(false);
+    cpucheck_chunk(true);
+  }
+
+  m68k_free(&cpu);
+  return EXIT_SUCCESS;
+}
+
+
+
@@ -5,20 +5,18 @@
 #include <string.h>
 #include <sys/stat.h>
 #include "console.h"
+#include "emu.h"
 #include "m68k.h"
 #include "m68k_trace.h"
 #include "mem.h"
 #include "panic.h"
 #include "ramdisk.h"
+#include "snapshot.h"
 
 
 
 #define DEBUGGER_ARGS 3
 
-#ifdef CPU_BREAKPOINT
-int32_t debugger_breakpoint_pc = -1;
-#endif /* CPU_BREAKPOINT */
-
 
 
 static void debugger_help(void)
@@ -34,8 +32,11 @@ static void debugger_help(void)
   fprintf(stdout, "  b <addr>       - Breakpoint\n");
 #endif /* CPU_BREAKPOINT */
   fprintf(stdout, "  t [full]       - Dump CPU Trace\n");
+  fprintf(stdout, "  T              - Toggle CPU Trace\n");
   fprintf(stdout, "  d <addr> [end] - Dump Memory\n");
   fprintf(stdout, "  f [filename]   - Save RAM Disk A\n");
+  fprintf(stdout, "  S <filename>   - Save Snapshot\n");
+  fprintf(stdout, "  L <filename>   - Load Snapshot\n");
 }
 
 
@@ -80,8 +81,11 @@ static bool debugger_overwrite(FILE *out, FILE *in, const char *filename)
 
 
 
-bool debugger(m68k_t *cpu, mem_t *mem, ramdisk_t *ramdisk)
+bool debugger(emu_t *emu)
 {
+  m68k_t *cpu = &emu->cpu;
+  mem_t *mem = &emu->mem;
+  ramdisk_t *ramdisk = &emu->ramdisk;
   char input[128];
   char *argv[3];
   int argc;
@@ -132,7 +136,7 @@ bool debugger(m68k_t *cpu, mem_t *mem, ramdisk_t *ramdisk)
       return true;
 
     } else if (strncmp(argv[0], "w", 1) == 0) {
-      if (console_warp_mode_toggle()) {
+      if (console_warp_mode_toggle(&emu->console)) {
         fprintf(stdout, "Warp mode enabled.\n");
       } else {
         fprintf(stdout, "Warp mode disabled.\n");
@@ -142,10 +146,10 @@ bool debugger(m68k_t *cpu, mem_t *mem, ramdisk_t *ramdisk)
       if (argc >= 2) {
         value1 = argv[1][0];
         if ((value1 >= 0x41) && (value1 <= 0x5A)) {
-          console_inject(value1 - 0x40);
+          console_inject(&emu->console, value1 - 0x40);
           fprintf(stdout, "Ctrl+%c sent.\n", value1);
         } else if ((value1 >= 0x61) && (value1 <= 0x7A)) {
-          console_inject(value1 - 0x60);
+          console_inject(&emu->console, value1 - 0x60);
           fprintf(stdout, "Ctrl+%c sent.\n", value1 - 0x20);
         } else {
           fprintf(stdout, "Invalid argument! (Use 'a' to 'z'.)\n");
@@ -158,28 +162,39 @@ bool debugger(m68k_t *cpu, mem_t *mem, ramdisk_t *ramdisk)
     } else if (strncmp(argv[0], "b", 1) == 0) {
       if (argc >= 2) {
         if (sscanf(argv[1], "%6x", &value1) == 1) {
-          debugger_breakpoint_pc = (value1 & 0xFFFFFF);
+          cpu->breakpoint_pc = (value1 & 0xFFFFFF);
           fprintf(stdout, "Breakpoint at 0x%06x set.\n",
-            debugger_breakpoint_pc);
+            cpu->breakpoint_pc);
         } else {
           fprintf(stdout, "Invalid argument!\n");
         }
       } else {
-        if (debugger_breakpoint_pc < 0) {
+        if (cpu->breakpoint_pc < 0) {
           fprintf(stdout, "Missing argument!\n");
         } else {
           fprintf(stdout, "Breakpoint at 0x%06x removed.\n",
-            debugger_breakpoint_pc);
+            cpu->breakpoint_pc);
         }
-        debugger_breakpoint_pc = -1;
+        cpu->breakpoint_pc = -1;
       }
 #endif /* CPU_BREAKPOINT */
 
     } else if (strncmp(argv[0], "t", 1) == 0) {
       if (argc >= 2) {
-        m68k_trace_dump(stdout, false);
+        m68k_trace_dump(emu->trace, stdout, false);
+      } else {
+        m68k_trace_dump(emu->trace, stdout, true);
+      }
+      if (! cpu->trace) {
+        fprintf(stdout, "CPU trace is disabled, use 'T' to enable.\n");
+      }
+
+    } else if (strncmp(argv[0], "T", 1) == 0) {
+      cpu->trace = ! cpu->trace;
+      if (cpu->trace) {
+        fprintf(stdout, "CPU trace enabled.\n");
       } else {
-        m68k_trace_dump(stdout, true);
+        fprintf(stdout, "CPU trace disabled.\n");
       }
 
     } else if (strncmp(argv[0], "d", 1) == 0) {
@@ -219,6 +234,32 @@ bool debugger(m68k_t *cpu, mem_t *mem, ramdisk_t *ramdisk)
         }
       }
 
+    } else if (strncmp(argv[0], "S", 1) == 0) {
+      if (argc >= 2) {
+        if (debugger_overwrite(stdout, stdin, argv[1])) {
+          result = snapshot_save(argv[1], emu);
+          if (result == 0) {
+            fprintf(stdout, "Snapshot saved.\n");
+          } else {
+            fprintf(stdout, "Snapshot save error: %d\n", result);
+          }
+        }
+      } else {
+        fprintf(stdout, "Missing argument!\n");
+      }
+
+    } else if (strncmp(argv[0], "L", 1) == 0) {
+      if (argc >= 2) {
+        result = snapshot_load(argv[1], emu);
+        if (result == 0) {
+          fprintf(stdout, "Snapshot loaded.\n");
+        } else {
+          fprintf(stdout, "Snapshot load error: %d\n", result);
+        }
+      } else {
+        fprintf(stdout, "Missing argument!\n");
+      }
+
     } else {
       fprintf(stdout, "Unknown command: '%c' (use 'h' for help.)\n",
         argv[0][0]);
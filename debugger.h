@@ -3,13 +3,8 @@
 
 #include <stdbool.h>
 #include <stdint.h>
-#include "m68k.h"
-#include "mem.h"
-#include "ramdisk.h"
+#include "emu.h"
 
-bool debugger(m68k_t *cpu, mem_t *mem, ramdisk_t *ramdisk);
-#ifdef CPU_BREAKPOINT
-extern int32_t debugger_breakpoint_pc;
-#endif /* CPU_BREAKPOINT */
+bool debugger(emu_t *emu);
 
 #endif /* _DEBUGGER_H */
@@ -0,0 +1,297 @@
+#include "emu.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "console.h"
+#include "expect.h"
+#include "m68k.h"
+#include "m68k_trace.h"
+#include "mem.h"
+#include "panic.h"
+#include "ramdisk.h"
+
+
+
+/* Identical empty status polls in a row before CP/M is put to sleep. */
+#define EMU_IDLE_LOOPS 16
+
+/* Writes allowed between those polls, the return address of the call to
+   the status routine, pushed one word at a time. */
+#define EMU_IDLE_WRITES 2
+
+
+
+void panic(void *context, const char *format, ...)
+{
+  emu_t *emu = context;
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(emu->panic_msg, sizeof(emu->panic_msg), format, args);
+  va_end(args);
+
+  emu->debugger_break = true;
+  emu->cpu.stop = M68K_RUN_PANIC;
+}
+
+
+
+/* CP/M waiting for a key spins in the BIOS conin loop, polling status with
+   the same registers every time and no memory writes besides the call. */
+static bool emu_idle_loop(emu_t *emu)
+{
+  m68k_t *cpu = &emu->cpu;
+
+  if (cpu->pc == emu->idle_pc && cpu->ssp == emu->idle_ssp &&
+    memcmp(&cpu->d[1], &emu->idle_d[1], 7 * sizeof(uint32_t)) == 0 &&
+    memcmp(cpu->a, emu->idle_a, sizeof(cpu->a)) == 0 &&
+    emu->mem.write_n - emu->idle_write_n <= EMU_IDLE_WRITES) {
+    emu->idle_loops++;
+  } else {
+    emu->idle_loops = 0;
+  }
+
+  emu->idle_pc = cpu->pc;
+  memcpy(emu->idle_d, cpu->d, sizeof(cpu->d));
+  memcpy(emu->idle_a, cpu->a, sizeof(cpu->a));
+  emu->idle_ssp = cpu->ssp;
+  emu->idle_write_n = emu->mem.write_n;
+
+  return emu->idle_loops >= EMU_IDLE_LOOPS &&
+    console_idle(&emu->console);
+}
+
+
+
+/* Returns true if a script driving the console has come to an end. */
+static bool emu_console_write(emu_t *emu, uint8_t value)
+{
+  console_write(&emu->console, value);
+  if (emu->expect == NULL) {
+    return false;
+  }
+  return expect_output(emu->expect, &emu->console, value);
+}
+
+
+
+static bool emu_trap_hook(void *context, uint32_t d[8])
+{
+  emu_t *emu = context;
+  int c;
+  int i;
+  int n;
+
+  switch (d[0]) {
+  case 1: /* Console Status */
+    d[0] = console_status(&emu->console);
+    if (d[0] == 0) {
+      if (emu->idle_break && console_idle(&emu->console)) {
+        emu->idle = true; /* Waiting at a prompt, with no input left. */
+        return true;
+      }
+      if (emu->expect != NULL && console_idle(&emu->console)) {
+        expect_idle(emu->expect); /* Nothing left that could be matched. */
+        return true;
+      }
+      if (emu_idle_loop(emu)) {
+        /* Nothing will happen until a key arrives, so let the host rest. */
+        console_input_sleep(&emu->console, &emu->debugger_break);
+      }
+    } else {
+      emu->idle_loops = 0;
+    }
+    break;
+
+  case 2: /* Console Read */
+    d[0] = console_read(&emu->console);
+    break;
+
+  case 3: /* Console Write */
+    if (emu_console_write(emu, d[1])) {
+      return true;
+    }
+    break;
+
+  case 4: /* RAM Disk Select */
+    d[0] = ramdisk_select(&emu->ramdisk, d[1]);
+    break;
+
+  case 5: /* RAM Disk Track Set */
+    ramdisk_track_set(&emu->ramdisk, d[1]);
+    break;
+
+  case 6: /* RAM Disk Sector Set */
+    ramdisk_sector_set(&emu->ramdisk, d[1]);
+    break;
+
+  case 7: /* RAM Disk DMA Set */
+    ramdisk_dma_set(&emu->ramdisk, d[1]);
+    break;
+
+  case 8: /* RAM Disk Read */
+    ramdisk_read(&emu->ramdisk, &emu->mem);
+    break;
+
+  case 9: /* RAM Disk Write */
+    ramdisk_write(&emu->ramdisk, &emu->mem);
+    break;
+
+  case 10: /* Remote Open */
+    memset(emu->remote_filename, '\0', sizeof(emu->remote_filename));
+    memset(emu->remote_lc_filename, '\0', sizeof(emu->remote_lc_filename));
+    n = 0;
+
+    for (i = 0; i < 8; i++) {
+      c = mem_read_byte(&emu->mem, d[1] + i);
+      if (c == 0x20) {
+        break;
+      }
+      emu->remote_filename[n] = c;
+      emu->remote_lc_filename[n] = tolower(c);
+      n++;
+    }
+
+    for (i = 0; i < 3; i++) {
+      c = mem_read_byte(&emu->mem, d[1] + 8 + i);
+      if (c == 0x20) {
+        break;
+      }
+      if (i == 0) { /* Add dot if there is an extension. */
+        emu->remote_filename[n] = '.';
+        emu->remote_lc_filename[n] = '.';
+        n++;
+      }
+      emu->remote_filename[n] = c;
+      emu->remote_lc_filename[n] = tolower(c);
+      n++;
+    }
+
+    emu->remote_fh = NULL;
+    if (d[2] == 'w') {
+      emu->remote_fh = fopen(emu->remote_filename, "wb");
+    } else if (d[2] == 'r') {
+      emu->remote_fh = fopen(emu->remote_filename, "rb");
+      if (emu->remote_fh == NULL && errno == ENOENT) {
+        /* Fallback to lowercase. */
+        emu->remote_fh = fopen(emu->remote_lc_filename, "rb");
+      }
+    }
+
+    if (emu->remote_fh == NULL) {
+      d[0] = 0xFF; /* Error */
+    } else {
+      d[0] = 0x00; /* OK */
+    }
+    break;
+
+  case 11: /* Remote Write */
+    if (emu->remote_fh == NULL) {
+      d[0] = 0xFF; /* Error */
+    } else {
+      for (i = 0; i < 128; i++) {
+        fputc(mem_read_byte(&emu->mem, d[1] + i), emu->remote_fh);
+      }
+      d[0] = 0x00; /* OK */
+    }
+    break;
+
+  case 12: /* Remote Read */
+    if (emu->remote_fh == NULL) {
+      d[0] = 0xFF; /* Error */
+    } else {
+      d[0] = 0x00; /* Maybe More */
+      for (i = 0; i < 128; i++) {
+        c = fgetc(emu->remote_fh);
+        if (c == EOF) {
+          if (i == 0) {
+            d[0] = 0x01; /* Done */
+            break;
+          }
+          c = '\0';
+        }
+        mem_write_byte(&emu->mem, d[1] + i, c);
+      }
+    }
+    break;
+
+  case 13: /* Remote Close */
+    if (emu->remote_fh != NULL) {
+      fclose(emu->remote_fh);
+    }
+    emu->remote_fh = NULL;
+    break;
+
+  case 14: /* Quit */
+    emu->quit = true;
+    return true;
+
+  default:
+    break;
+  }
+
+  return emu->debugger_break; /* Leave CPU run loop if break is pending. */
+}
+
+
+
+emu_t *emu_create(int trace_size)
+{
+  emu_t *emu;
+
+  emu = calloc(1, sizeof(emu_t));
+  if (emu == NULL) {
+    return NULL;
+  }
+
+  mem_init(&emu->mem);
+  console_init(&emu->console);
+  emu->console.context = emu;
+
+  if (ramdisk_init(&emu->ramdisk) != 0) {
+    emu_destroy(emu);
+    return NULL;
+  }
+  emu->ramdisk.context = emu;
+
+  if (m68k_init(&emu->cpu) != 0) {
+    emu_destroy(emu);
+    return NULL;
+  }
+  emu->cpu.trap_15_hook = emu_trap_hook;
+  emu->cpu.context = emu;
+
+  emu->trace = m68k_trace_create(trace_size);
+  if (emu->trace == NULL) {
+    emu_destroy(emu);
+    return NULL;
+  }
+  emu->cpu.trace_state = emu->trace;
+
+  return emu;
+}
+
+
+
+void emu_destroy(emu_t *emu)
+{
+  if (emu == NULL) {
+    return;
+  }
+  if (emu->remote_fh != NULL) {
+    fclose(emu->remote_fh);
+  }
+  m68k_trace_destroy(emu->trace);
+  m68k_free(&emu->cpu);
+  ramdisk_free(&emu->ramdisk);
+  console_free(&emu->console);
+  free(emu);
+}
+
+
+
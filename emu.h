@@ -0,0 +1,45 @@
+#ifndef _EMU_H
+#define _EMU_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "console.h"
+#include "expect.h"
+#include "m68k.h"
+#include "m68k_trace.h"
+#include "mem.h"
+#include "ramdisk.h"
+
+/* Everything one emulated CP/M machine needs, so several can run in the
+   same process, each on its own thread. */
+typedef struct emu_s {
+  m68k_t cpu;
+  mem_t mem;
+  ramdisk_t ramdisk;
+  console_t console;
+  m68k_trace_t *trace;
+  expect_t *expect; /* Script driving the console, or NULL. */
+
+  bool debugger_break; /* Leave m68k_run() for the debugger. */
+  bool idle_break; /* Leave m68k_run() when CP/M waits for input... */
+  bool idle; /* ...and flag it here. */
+  bool quit; /* QUIT requested by CP/M. */
+  char panic_msg[80];
+
+  /* Guest state at the last empty console status poll. */
+  uint32_t idle_pc;
+  uint32_t idle_d[8];
+  uint32_t idle_a[8];
+  uint32_t idle_ssp;
+  uint32_t idle_write_n;
+  uint32_t idle_loops;
+
+  char remote_filename[16];
+  char remote_lc_filename[16];
+  FILE *remote_fh;
+} emu_t;
+
+emu_t *emu_create(int trace_size);
+void emu_destroy(emu_t *emu);
+
+#endif /* _EMU_H */
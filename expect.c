@@ -0,0 +1,395 @@
+#include "expect.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "console.h"
+
+
+
+#define EXPECT_LINE_MAX 1024
+
+/* Longest timeout accepted, a day. */
+#define EXPECT_TIMEOUT_MAX_S 86400
+
+
+
+static int expect_hex(int c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  return tolower(c) - 'a' + 10;
+}
+
+
+
+/* Text is taken as is, or between double quotes to keep spaces at the
+   ends. Both understand \r, \n, \t, \e, \\, \" and \xHH escapes. */
+static int expect_text_parse(const char *s, expect_step_t *step)
+{
+  bool quoted = false;
+  int c;
+
+  if (*s == '"') {
+    quoted = true;
+    s++;
+  }
+
+  step->text_n = 0;
+  while (*s != '\0') {
+    c = (unsigned char)*s;
+    s++;
+
+    if (quoted && c == '"') {
+      if (*s != '\0') {
+        return -2; /* Trailing garbage. */
+      }
+      quoted = false;
+      break;
+    }
+
+    if (c == '\\') {
+      c = (unsigned char)*s;
+      s++;
+      switch (c) {
+      case 'r':
+        c = 0x0D;
+        break;
+      case 'n':
+        c = 0x0A;
+        break;
+      case 't':
+        c = 0x09;
+        break;
+      case 'e':
+        c = 0x1B;
+        break;
+      case '\\':
+      case '"':
+        break;
+      case 'x':
+        if (! isxdigit((unsigned char)s[0]) ||
+          ! isxdigit((unsigned char)s[1])) {
+          return -2;
+        }
+        c = (expect_hex(s[0]) << 4) | expect_hex(s[1]);
+        s += 2;
+        break;
+      default:
+        return -2;
+      }
+    }
+
+    if (step->text_n >= EXPECT_TEXT_MAX) {
+      return -2;
+    }
+    step->text[step->text_n] = c;
+    step->text_n++;
+  }
+
+  if (quoted || step->text_n == 0) {
+    return -2;
+  }
+  return 0;
+}
+
+
+
+static int expect_number_parse(const char *s, long min, long max,
+  long *value)
+{
+  char *end;
+
+  *value = strtol(s, &end, 10);
+  if (end == s || *end != '\0' || *value < min || *value > max) {
+    return -2;
+  }
+  return 0;
+}
+
+
+
+/* One step per line, a '#' at the start of a line makes it a comment:
+     expect TEXT     Wait for TEXT in the console output.
+     send TEXT       Inject TEXT as input.
+     timeout SECS    Time allowed for the expect steps that follow.
+     fail CODE       Exit code when those do not match.
+     exit CODE       Quit the emulator with exit code CODE. */
+int expect_load(expect_t *expect, const char *filename)
+{
+  FILE *fh;
+  char line[EXPECT_LINE_MAX];
+  char *command;
+  char *arg;
+  char *end;
+  expect_step_t step;
+  expect_step_t *steps;
+  int timeout_ms = EXPECT_TIMEOUT_DEFAULT_MS;
+  int fail = EXPECT_FAIL_DEFAULT;
+  double seconds;
+  long value;
+  size_t len;
+  int line_n = 0;
+  int result = 0;
+
+  fh = fopen(filename, "r");
+  if (fh == NULL) {
+    return -1;
+  }
+
+  while (fgets(line, sizeof(line), fh) != NULL) {
+    line_n++;
+    len = strlen(line);
+    if (len == sizeof(line) - 1 && line[len - 1] != '\n' && ! feof(fh)) {
+      result = -2; /* Line too long. */
+      break;
+    }
+    while (len > 0 && isspace((unsigned char)line[len - 1])) {
+      len--;
+      line[len] = '\0';
+    }
+
+    command = line;
+    while (isspace((unsigned char)*command)) {
+      command++;
+    }
+    if (*command == '\0' || *command == '#') {
+      continue;
+    }
+    arg = command;
+    while (*arg != '\0' && ! isspace((unsigned char)*arg)) {
+      arg++;
+    }
+    if (*arg != '\0') {
+      *arg = '\0';
+      arg++;
+      while (isspace((unsigned char)*arg)) {
+        arg++;
+      }
+    }
+
+    memset(&step, 0, sizeof(expect_step_t));
+    step.line = line_n;
+    step.timeout_ms = timeout_ms;
+    step.code = fail;
+
+    if (strcmp(command, "expect") == 0) {
+      step.type = EXPECT_STEP_EXPECT;
+      result = expect_text_parse(arg, &step);
+
+    } else if (strcmp(command, "send") == 0) {
+      step.type = EXPECT_STEP_SEND;
+      result = expect_text_parse(arg, &step);
+
+    } else if (strcmp(command, "exit") == 0) {
+      step.type = EXPECT_STEP_EXIT;
+      result = expect_number_parse(arg, 0, 255, &value);
+      step.code = value;
+
+    } else if (strcmp(command, "timeout") == 0) {
+      seconds = strtod(arg, &end);
+      if (end == arg || *end != '\0' || seconds < 0 ||
+        seconds > EXPECT_TIMEOUT_MAX_S) {
+        result = -2;
+        break;
+      }
+      timeout_ms = seconds * 1000;
+      continue;
+
+    } else if (strcmp(command, "fail") == 0) {
+      result = expect_number_parse(arg, 0, 255, &value);
+      fail = value;
+      if (result != 0) {
+        break;
+      }
+      continue;
+
+    } else {
+      result = -2;
+    }
+
+    if (result != 0) {
+      break;
+    }
+
+    steps = realloc(expect->step, (expect->step_n + 1) *
+      sizeof(expect_step_t));
+    if (steps == NULL) {
+      result = -3;
+      break;
+    }
+    expect->step = steps;
+    expect->step[expect->step_n] = step;
+    expect->step_n++;
+  }
+
+  if (result == -2) {
+    expect->line = line_n;
+  }
+  if (result == 0 && ferror(fh)) {
+    result = -1;
+  }
+  fclose(fh);
+  return result;
+}
+
+
+
+/* Where to continue the match from after a mismatch, the longest start of
+   the text that also ends the part matched so far. */
+static void expect_fallback_init(expect_t *expect, const expect_step_t *step)
+{
+  int i;
+  int k = 0;
+
+  expect->fallback[0] = 0;
+  for (i = 1; i < step->text_n; i++) {
+    while (k > 0 && step->text[i] != step->text[k]) {
+      k = expect->fallback[k - 1];
+    }
+    if (step->text[i] == step->text[k]) {
+      k++;
+    }
+    expect->fallback[i] = k;
+  }
+}
+
+
+
+/* Run the steps that need no waiting, up to the next expect step. */
+static void expect_advance(expect_t *expect, console_t *console)
+{
+  expect_step_t *step;
+  int i;
+
+  while (expect->current < expect->step_n) {
+    step = &expect->step[expect->current];
+    switch (step->type) {
+    case EXPECT_STEP_SEND:
+      for (i = 0; i < step->text_n; i++) {
+        console_inject(console, step->text[i]);
+      }
+      expect->current++;
+      break;
+
+    case EXPECT_STEP_EXPECT:
+      expect->matched = 0;
+      expect_fallback_init(expect, step);
+      clock_gettime(CLOCK_MONOTONIC, &expect->since);
+      return;
+
+    case EXPECT_STEP_EXIT:
+      expect->state = EXPECT_EXIT;
+      expect->exit_code = step->code;
+      return;
+    }
+  }
+
+  expect->state = EXPECT_DONE;
+}
+
+
+
+void expect_start(expect_t *expect, console_t *console)
+{
+  expect->current = 0;
+  expect->state = EXPECT_RUNNING;
+  expect_advance(expect, console);
+}
+
+
+
+/* Fed every character written to the console, returns true when the
+   script has come to an end. */
+bool expect_output(expect_t *expect, console_t *console, uint8_t value)
+{
+  expect_step_t *step;
+
+  if (expect->state != EXPECT_RUNNING) {
+    return false;
+  }
+  step = &expect->step[expect->current];
+
+  while (expect->matched > 0 && value != step->text[expect->matched]) {
+    expect->matched = expect->fallback[expect->matched - 1];
+  }
+  if (value == step->text[expect->matched]) {
+    expect->matched++;
+  }
+
+  if (expect->matched == step->text_n) {
+    expect->current++;
+    expect_advance(expect, console);
+    return expect->state != EXPECT_RUNNING;
+  }
+  return false;
+}
+
+
+
+/* Called regularly from the run loop, returns true when timed out. */
+bool expect_timer(expect_t *expect)
+{
+  expect_step_t *step;
+  struct timespec now;
+
+  if (expect->state != EXPECT_RUNNING) {
+    return false;
+  }
+  step = &expect->step[expect->current];
+  if (step->timeout_ms == 0) {
+    return false;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (((now.tv_sec - expect->since.tv_sec) * 1000) +
+    ((now.tv_nsec - expect->since.tv_nsec) / 1000000) >= step->timeout_ms) {
+    expect->state = EXPECT_TIMEOUT;
+    expect->exit_code = step->code;
+    return true;
+  }
+  return false;
+}
+
+
+
+/* Called when CP/M waits for input with none left to inject, so no more
+   output will come that could match. Returns true if that fails a step. */
+bool expect_idle(expect_t *expect)
+{
+  if (expect->state != EXPECT_RUNNING) {
+    return false;
+  }
+  expect->state = EXPECT_STUCK;
+  expect->exit_code = expect->step[expect->current].code;
+  return true;
+}
+
+
+
+void expect_init(expect_t *expect)
+{
+  expect->step = NULL;
+  expect->step_n = 0;
+  expect->current = 0;
+  expect->state = EXPECT_DONE;
+  expect->exit_code = 0;
+  expect->line = 0;
+  expect->matched = 0;
+}
+
+
+
+void expect_free(expect_t *expect)
+{
+  free(expect->step);
+  expect->step = NULL;
+  expect->step_n = 0;
+}
+
+
+
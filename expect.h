@@ -0,0 +1,60 @@
+#ifndef _EXPECT_H
+#define _EXPECT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "console.h"
+
+#define EXPECT_TEXT_MAX 256
+
+#define EXPECT_TIMEOUT_DEFAULT_MS 10000
+#define EXPECT_FAIL_DEFAULT 1
+
+typedef enum {
+  EXPECT_STEP_EXPECT,
+  EXPECT_STEP_SEND,
+  EXPECT_STEP_EXIT,
+} expect_step_type_t;
+
+typedef struct expect_step_s {
+  expect_step_type_t type;
+  uint8_t text[EXPECT_TEXT_MAX];
+  int text_n;
+  int timeout_ms; /* Zero for none. */
+  int code; /* Exit code when timed out or stuck, or of the exit step. */
+  int line;
+} expect_step_t;
+
+typedef enum {
+  EXPECT_RUNNING,
+  EXPECT_DONE,    /* All steps done, the keyboard takes over. */
+  EXPECT_EXIT,    /* Exit step reached. */
+  EXPECT_TIMEOUT, /* Expected text did not show up in time. */
+  EXPECT_STUCK,   /* CP/M waits for input, so it never will. */
+} expect_state_t;
+
+typedef struct expect_s {
+  expect_step_t *step;
+  int step_n;
+  int current;
+  expect_state_t state;
+  int exit_code;
+  int line; /* Of a syntax error when loading. */
+
+  /* Incremental matching of the current expect step, the text matched so
+     far and where to fall back to when the next character does not fit. */
+  int matched;
+  int fallback[EXPECT_TEXT_MAX];
+  struct timespec since;
+} expect_t;
+
+void expect_init(expect_t *expect);
+void expect_free(expect_t *expect);
+int expect_load(expect_t *expect, const char *filename);
+void expect_start(expect_t *expect, console_t *console);
+bool expect_output(expect_t *expect, console_t *console, uint8_t value);
+bool expect_timer(expect_t *expect);
+bool expect_idle(expect_t *expect);
+
+#endif /* _EXPECT_H */
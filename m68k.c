@@ -1,4 +1,5 @@
 #include "m68k.h"
+#include <pthread.h>
 #include <setjmp.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -11,12 +12,25 @@
 
 
 
+#if defined(CPU_TRACE_RUNTIME) && defined(CPU_TRACE)
+/* Traced copy of the core, linked next to the untraced one. */
+#define m68k_run m68k_run_traced
+#define m68k_init m68k_init_traced
+#define m68k_free m68k_free_traced
+#define m68k_cc_flush m68k_cc_flush_traced
+#endif
+
+#ifdef CPU_TRACE
+#define M68K_CORE_INDEX 1
+#else
+#define M68K_CORE_INDEX 0
+#endif
+
+#define M68K_CORE(cpu) ((cpu)->core[M68K_CORE_INDEX])
+
 #ifndef CPU_TRACE
 #define m68k_trace_start(...)
 #define m68k_trace_mc(...)
-#define m68k_trace_op_mnemonic(...)
-#define m68k_trace_op_src(...)
-#define m68k_trace_op_dst(...)
 #define m68k_trace_end(...)
 #endif
 
@@ -34,7 +48,53 @@
 #define EA_MODE_EXT_PC_DISP_8    0b011 /* (d8,PC,Xn) */
 #define EA_MODE_EXT_IMMEDIATE    0b100 /* #<data> */
 
-static jmp_buf m68k_exception_jmp;
+#define M68K_BLOCK_CACHE_SIZE 4096 /* Must be a power of two. */
+#define M68K_BLOCK_INSN_MAX 32
+#define M68K_BLOCK_WORD_MAX 64
+#define M68K_INSN_WORD_MAX 5 /* Longest 68000 instruction. */
+
+typedef void (*m68k_handler_t)(m68k_t *cpu, mem_t *mem, uint16_t opcode);
+
+/* Effective address extension words, as decoded by m68k_operand_fetch(). */
+typedef struct m68k_operand_s {
+  uint32_t value;    /* Displacement, Address or Immediate Data */
+  uint16_t key;      /* Width, Mode and Register Decoded for */
+  uint16_t ext_word; /* Last Extension Word, Index Register if Brief */
+  uint8_t words;     /* Extension Words, Zero if None */
+} m68k_operand_t;
+
+typedef struct m68k_block_s {
+  uint32_t pc;      /* Start Address, Odd if Unused */
+  uint32_t page[2]; /* First and Last Memory Page Covered */
+  uint32_t gen[2];  /* Page Generations when Decoded */
+  int insn_n;
+  int word_n;
+  uint8_t insn_offset[M68K_BLOCK_INSN_MAX]; /* Word Index per Instruction */
+#ifdef CPU_THREADED
+  void *label[M68K_BLOCK_INSN_MAX]; /* Handler Labels in m68k_run() */
+#else
+  m68k_handler_t handler[M68K_BLOCK_INSN_MAX];
+#endif /* CPU_THREADED */
+  uint16_t word[M68K_BLOCK_WORD_MAX];
+  m68k_operand_t operand[M68K_BLOCK_INSN_MAX][2]; /* Source, Destination */
+  struct m68k_block_s *link[2]; /* Successor Blocks, if Chaining */
+  int link_next; /* Link Slot to Replace Next */
+} m68k_block_t;
+
+/* Per-instance state of this core, the traced core has its own. */
+typedef struct m68k_core_s {
+  jmp_buf exception_jmp;
+  m68k_block_t block_cache[M68K_BLOCK_CACHE_SIZE];
+  m68k_block_t *block_replay; /* Block being executed from cache. */
+  m68k_block_t *block_record; /* Block being decoded into cache. */
+  bool block_record_broken; /* Non-sequential fetch seen. */
+  int block_insn; /* Current instruction index in block. */
+  m68k_block_t *block_prev; /* Block to link to the next one. */
+} m68k_core_t;
+
+/* Shared by all instances, only written once. */
+static m68k_handler_t m68k_opcode_table[0x10000];
+static pthread_once_t m68k_opcode_table_once = PTHREAD_ONCE_INIT;
 
 
 
@@ -46,6 +106,52 @@ static inline uint16_t m68k_sr_filter_bits(uint16_t value)
 
 
 
+static inline void m68k_cc_set(m68k_t *cpu, m68k_cc_op_t op,
+  uint32_t src, uint32_t dst, uint32_t res, uint32_t msb)
+{
+  cpu->cc_op  = op;
+  cpu->cc_src = src;
+  cpu->cc_dst = dst;
+  cpu->cc_res = res;
+  cpu->cc_msb = msb;
+}
+
+
+
+void m68k_cc_flush(m68k_t *cpu)
+{
+  uint32_t src = cpu->cc_src;
+  uint32_t dst = cpu->cc_dst;
+  uint32_t res = cpu->cc_res;
+  uint32_t msb = cpu->cc_msb;
+
+  switch (cpu->cc_op) {
+  case M68K_CC_NONE:
+    return;
+
+  case M68K_CC_ADD:
+    cpu->status.c = res < dst;
+    cpu->status.v = (~(src ^ dst) & (src ^ res) & msb) > 0;
+    break;
+
+  case M68K_CC_SUB:
+    cpu->status.c = src > dst;
+    cpu->status.v = ((dst ^ src) & (dst ^ res) & msb) > 0;
+    break;
+
+  case M68K_CC_LOGIC:
+    cpu->status.c = 0;
+    cpu->status.v = 0;
+    break;
+  }
+
+  cpu->status.n = (res & msb) > 0;
+  cpu->status.z = res == 0;
+  cpu->cc_op = M68K_CC_NONE;
+}
+
+
+
 static inline uint32_t m68k_address_reg_value(m68k_t *cpu, uint8_t reg)
 {
   if (reg == M68K_SP && cpu->status.s == 1) {
@@ -141,13 +247,38 @@ static inline void m68k_address_reg_dec(m68k_t *cpu, uint8_t reg, int width)
 
 static inline uint16_t m68k_fetch(m68k_t *cpu, mem_t *mem)
 {
+  m68k_core_t *core = M68K_CORE(cpu);
+  m68k_block_t *block;
   bool error = false;
-  cpu->opcode = mem_read_word(mem, cpu->pc, &error);
+  uint32_t index;
+
+  if (core->block_replay != NULL) {
+    block = core->block_replay;
+    index = (cpu->pc - block->pc) >> 1;
+    if (index < (uint32_t)block->word_n) {
+      cpu->opcode = block->word[index];
+    } else {
+      cpu->opcode = mem_read_word(mem, cpu->pc, &error);
+    }
+  } else {
+    cpu->opcode = mem_read_word(mem, cpu->pc, &error);
+    if (core->block_record != NULL) {
+      block = core->block_record;
+      if (cpu->pc == block->pc + (block->word_n * 2) &&
+        block->word_n < M68K_BLOCK_WORD_MAX) {
+        block->word[block->word_n] = cpu->opcode;
+        block->word_n++;
+      } else {
+        core->block_record_broken = true;
+      }
+    }
+  }
+
   cpu->pc += 2;
   if (cpu->pc > 0xFFFFFF) {
-    panic("Program Counter Overflow!\n");
+    panic(cpu->context, "Program Counter Overflow!\n");
   }
-  m68k_trace_mc(cpu->opcode);
+  m68k_trace_mc(cpu->trace_state, cpu->opcode);
   return cpu->opcode;
 }
 
@@ -213,6 +344,8 @@ static inline void m68k_address_error(m68k_t *cpu, mem_t *mem,
   bool error = false;
   uint16_t value;
 
+  m68k_cc_flush(cpu);
+
   m68k_ssp_push(cpu, mem, cpu->pc % 0x10000);
   m68k_ssp_push(cpu, mem, cpu->pc / 0x10000);
   m68k_ssp_push(cpu, mem, cpu->sr);
@@ -241,7 +374,7 @@ static inline void m68k_address_error(m68k_t *cpu, mem_t *mem,
   cpu->sr &= ~0x8000; /* Clear Trace Bit */
   cpu->sr |= 0x2000; /* Set Supervisor Bit */
 
-  longjmp(m68k_exception_jmp, 1);
+  longjmp(M68K_CORE(cpu)->exception_jmp, 1);
 }
 
 
@@ -250,6 +383,8 @@ static inline void m68k_exception(m68k_t *cpu, mem_t *mem, uint32_t vector)
 {
   bool error = false;
 
+  m68k_cc_flush(cpu);
+
   cpu->pc = cpu->old_pc;
   m68k_ssp_push(cpu, mem, cpu->pc % 0x10000);
   m68k_ssp_push(cpu, mem, cpu->pc / 0x10000);
@@ -258,7 +393,7 @@ static inline void m68k_exception(m68k_t *cpu, mem_t *mem, uint32_t vector)
   cpu->sr &= ~0x8000; /* Clear Trace Bit */
   cpu->sr |= 0x2000; /* Set Supervisor Bit */
 
-  longjmp(m68k_exception_jmp, 1);
+  longjmp(M68K_CORE(cpu)->exception_jmp, 1);
 }
 
 
@@ -266,12 +401,8 @@ static inline void m68k_exception(m68k_t *cpu, mem_t *mem, uint32_t vector)
 static uint8_t m68k_add_byte(m68k_t *cpu, uint8_t in1, uint8_t in2)
 {
   uint8_t result = in1 + in2;
-  cpu->status.n = result >> 7;
-  cpu->status.z = result == 0;
-  cpu->status.c = ((uint16_t)(in1 + in2) & 0x100) > 0;
-  cpu->status.v = (((in1 & 0x80) && (in2 & 0x80) && !(result & 0x80)) ||
-                  (!(in1 & 0x80) && !(in2 & 0x80) && (result & 0x80)));
-  cpu->status.x = cpu->status.c;
+  m68k_cc_set(cpu, M68K_CC_ADD, in2, in1, result, 0x80);
+  cpu->status.x = result < in1;
   return result;
 }
 
@@ -282,12 +413,8 @@ static uint16_t m68k_add_word(m68k_t *cpu, uint16_t in1, uint16_t in2,
   if (skip_cc_set) {
     return result;
   }
-  cpu->status.n = result >> 15;
-  cpu->status.z = result == 0;
-  cpu->status.c = ((uint32_t)(in1 + in2) & 0x10000) > 0;
-  cpu->status.v = (((in1 & 0x8000) && (in2 & 0x8000) && !(result & 0x8000)) ||
-                  (!(in1 & 0x8000) && !(in2 & 0x8000) && (result & 0x8000)));
-  cpu->status.x = cpu->status.c;
+  m68k_cc_set(cpu, M68K_CC_ADD, in2, in1, result, 0x8000);
+  cpu->status.x = result < in1;
   return result;
 }
 
@@ -298,16 +425,8 @@ static uint32_t m68k_add_long(m68k_t *cpu, uint32_t in1, uint32_t in2,
   if (skip_cc_set) {
     return result;
   }
-  cpu->status.n = result >> 31;
-  cpu->status.z = result == 0;
-  cpu->status.c = (((uint64_t)in1 + (uint64_t)in2) & 0x100000000) > 0;
-  cpu->status.v = (((in1 & 0x80000000) &&
-                    (in2 & 0x80000000) &&
-                !(result & 0x80000000)) ||
-                  (!(in1 & 0x80000000) &&
-                   !(in2 & 0x80000000) &&
-                 (result & 0x80000000)));
-  cpu->status.x = cpu->status.c;
+  m68k_cc_set(cpu, M68K_CC_ADD, in2, in1, result, 0x80000000);
+  cpu->status.x = result < in1;
   return result;
 }
 
@@ -316,6 +435,7 @@ static uint32_t m68k_add_long(m68k_t *cpu, uint32_t in1, uint32_t in2,
 static uint8_t m68k_addx_byte(m68k_t *cpu, uint8_t in1, uint8_t in2)
 {
   uint8_t result = in1 + in2 + cpu->status.x;
+  m68k_cc_flush(cpu);
   cpu->status.n = result >> 7;
   if (result != 0) {
     cpu->status.z = 0;
@@ -330,6 +450,7 @@ static uint8_t m68k_addx_byte(m68k_t *cpu, uint8_t in1, uint8_t in2)
 static uint16_t m68k_addx_word(m68k_t *cpu, uint16_t in1, uint16_t in2)
 {
   uint16_t result = in1 + in2 + cpu->status.x;
+  m68k_cc_flush(cpu);
   cpu->status.n = result >> 15;
   if (result != 0) {
     cpu->status.z = 0;
@@ -344,6 +465,7 @@ static uint16_t m68k_addx_word(m68k_t *cpu, uint16_t in1, uint16_t in2)
 static uint32_t m68k_addx_long(m68k_t *cpu, uint32_t in1, uint32_t in2)
 {
   uint32_t result = in1 + in2 + cpu->status.x;
+  m68k_cc_flush(cpu);
   cpu->status.n = result >> 31;
   if (result != 0) {
     cpu->status.z = 0;
@@ -365,6 +487,7 @@ static uint32_t m68k_addx_long(m68k_t *cpu, uint32_t in1, uint32_t in2)
 static uint8_t m68k_add_bcd(m68k_t *cpu, uint8_t in1, uint8_t in2)
 {
   uint16_t result = (in1 & 0x0F) + (in2 & 0x0F) + cpu->status.x;
+  m68k_cc_flush(cpu);
   if (result > 9) {
     result += 6;
   }
@@ -388,30 +511,21 @@ static uint8_t m68k_add_bcd(m68k_t *cpu, uint8_t in1, uint8_t in2)
 static uint8_t m68k_and_byte(m68k_t *cpu, uint8_t in1, uint8_t in2)
 {
   uint8_t result = in1 & in2;
-  cpu->status.n = result >> 7;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x80);
   return result;
 }
 
 static uint16_t m68k_and_word(m68k_t *cpu, uint16_t in1, uint16_t in2)
 {
   uint16_t result = in1 & in2;
-  cpu->status.n = result >> 15;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x8000);
   return result;
 }
 
 static uint32_t m68k_and_long(m68k_t *cpu, uint32_t in1, uint32_t in2)
 {
   uint32_t result = in1 & in2;
-  cpu->status.n = result >> 31;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x80000000);
   return result;
 }
 
@@ -420,6 +534,7 @@ static uint32_t m68k_and_long(m68k_t *cpu, uint32_t in1, uint32_t in2)
 static uint8_t m68k_asl_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 {
   bool msb = input >> 7;
+  m68k_cc_flush(cpu);
   cpu->status.v = 0;
   if (count == 0) {
     cpu->status.c = 0;
@@ -442,6 +557,7 @@ static uint8_t m68k_asl_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 static uint16_t m68k_asl_word(m68k_t *cpu, uint16_t input, uint8_t count)
 {
   bool msb = input >> 15;
+  m68k_cc_flush(cpu);
   cpu->status.v = 0;
   if (count == 0) {
     cpu->status.c = 0;
@@ -464,6 +580,7 @@ static uint16_t m68k_asl_word(m68k_t *cpu, uint16_t input, uint8_t count)
 static uint32_t m68k_asl_long(m68k_t *cpu, uint32_t input, uint8_t count)
 {
   bool msb = input >> 31;
+  m68k_cc_flush(cpu);
   cpu->status.v = 0;
   if (count == 0) {
     cpu->status.c = 0;
@@ -487,6 +604,7 @@ static uint32_t m68k_asl_long(m68k_t *cpu, uint32_t input, uint8_t count)
 
 static uint8_t m68k_asr_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -506,6 +624,7 @@ static uint8_t m68k_asr_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 
 static uint16_t m68k_asr_word(m68k_t *cpu, uint16_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -525,6 +644,7 @@ static uint16_t m68k_asr_word(m68k_t *cpu, uint16_t input, uint8_t count)
 
 static uint32_t m68k_asr_long(m68k_t *cpu, uint32_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -546,36 +666,17 @@ static uint32_t m68k_asr_long(m68k_t *cpu, uint32_t input, uint8_t count)
 
 static void m68k_cmp_byte(m68k_t *cpu, uint8_t sub, uint8_t min)
 {
-  uint8_t result = min - sub;
-  cpu->status.n = result >> 7;
-  cpu->status.z = result == 0;
-  cpu->status.c = ((uint16_t)(min - sub) & 0x100) > 0;
-  cpu->status.v = (((min & 0x80) && !(sub & 0x80) && !(result & 0x80)) ||
-                  (!(min & 0x80) && (sub & 0x80) && (result & 0x80)));
+  m68k_cc_set(cpu, M68K_CC_SUB, sub, min, (uint8_t)(min - sub), 0x80);
 }
 
 static void m68k_cmp_word(m68k_t *cpu, uint16_t sub, uint16_t min)
 {
-  uint16_t result = min - sub;
-  cpu->status.n = result >> 15;
-  cpu->status.z = result == 0;
-  cpu->status.c = ((uint32_t)(min - sub) & 0x10000) > 0;
-  cpu->status.v = (((min & 0x8000) && !(sub & 0x8000) && !(result & 0x8000)) ||
-                  (!(min & 0x8000) && (sub & 0x8000) && (result & 0x8000)));
+  m68k_cc_set(cpu, M68K_CC_SUB, sub, min, (uint16_t)(min - sub), 0x8000);
 }
 
 static void m68k_cmp_long(m68k_t *cpu, uint32_t sub, uint32_t min)
 {
-  uint32_t result = min - sub;
-  cpu->status.n = result >> 31;
-  cpu->status.z = result == 0;
-  cpu->status.c = (((uint64_t)min - (uint64_t)sub) & 0x100000000) > 0;
-  cpu->status.v = (((min & 0x80000000) &&
-                   !(sub & 0x80000000) &&
-                !(result & 0x80000000)) ||
-                  (!(min & 0x80000000) &&
-                    (sub & 0x80000000) &&
-                 (result & 0x80000000)));
+  m68k_cc_set(cpu, M68K_CC_SUB, sub, min, (uint32_t)(min - sub), 0x80000000);
 }
 
 
@@ -583,30 +684,21 @@ static void m68k_cmp_long(m68k_t *cpu, uint32_t sub, uint32_t min)
 static uint8_t m68k_eor_byte(m68k_t *cpu, uint8_t in1, uint8_t in2)
 {
   uint8_t result = in1 ^ in2;
-  cpu->status.n = result >> 7;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x80);
   return result;
 }
 
 static uint16_t m68k_eor_word(m68k_t *cpu, uint16_t in1, uint16_t in2)
 {
   uint16_t result = in1 ^ in2;
-  cpu->status.n = result >> 15;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x8000);
   return result;
 }
 
 static uint32_t m68k_eor_long(m68k_t *cpu, uint32_t in1, uint32_t in2)
 {
   uint32_t result = in1 ^ in2;
-  cpu->status.n = result >> 31;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x80000000);
   return result;
 }
 
@@ -614,6 +706,7 @@ static uint32_t m68k_eor_long(m68k_t *cpu, uint32_t in1, uint32_t in2)
 
 static uint8_t m68k_lsl_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -632,6 +725,7 @@ static uint8_t m68k_lsl_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 
 static uint16_t m68k_lsl_word(m68k_t *cpu, uint16_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -650,6 +744,7 @@ static uint16_t m68k_lsl_word(m68k_t *cpu, uint16_t input, uint8_t count)
 
 static uint32_t m68k_lsl_long(m68k_t *cpu, uint32_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -670,6 +765,7 @@ static uint32_t m68k_lsl_long(m68k_t *cpu, uint32_t input, uint8_t count)
 
 static uint8_t m68k_lsr_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -688,6 +784,7 @@ static uint8_t m68k_lsr_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 
 static uint16_t m68k_lsr_word(m68k_t *cpu, uint16_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -706,6 +803,7 @@ static uint16_t m68k_lsr_word(m68k_t *cpu, uint16_t input, uint8_t count)
 
 static uint32_t m68k_lsr_long(m68k_t *cpu, uint32_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -726,6 +824,7 @@ static uint32_t m68k_lsr_long(m68k_t *cpu, uint32_t input, uint8_t count)
 
 static uint8_t m68k_not_byte(m68k_t *cpu, uint8_t input)
 {
+  m68k_cc_flush(cpu);
   input = ~input;
   cpu->status.n = input >> 7;
   cpu->status.z = input == 0;
@@ -736,6 +835,7 @@ static uint8_t m68k_not_byte(m68k_t *cpu, uint8_t input)
 
 static uint16_t m68k_not_word(m68k_t *cpu, uint16_t input)
 {
+  m68k_cc_flush(cpu);
   input = ~input;
   cpu->status.n = input >> 15;
   cpu->status.z = input == 0;
@@ -746,6 +846,7 @@ static uint16_t m68k_not_word(m68k_t *cpu, uint16_t input)
 
 static uint32_t m68k_not_long(m68k_t *cpu, uint32_t input)
 {
+  m68k_cc_flush(cpu);
   input = ~input;
   cpu->status.n = input >> 31;
   cpu->status.z = input == 0;
@@ -759,30 +860,21 @@ static uint32_t m68k_not_long(m68k_t *cpu, uint32_t input)
 static uint8_t m68k_or_byte(m68k_t *cpu, uint8_t in1, uint8_t in2)
 {
   uint8_t result = in1 | in2;
-  cpu->status.n = result >> 7;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x80);
   return result;
 }
 
 static uint16_t m68k_or_word(m68k_t *cpu, uint16_t in1, uint16_t in2)
 {
   uint16_t result = in1 | in2;
-  cpu->status.n = result >> 15;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x8000);
   return result;
 }
 
 static uint32_t m68k_or_long(m68k_t *cpu, uint32_t in1, uint32_t in2)
 {
   uint32_t result = in1 | in2;
-  cpu->status.n = result >> 31;
-  cpu->status.z = result == 0;
-  cpu->status.c = 0;
-  cpu->status.v = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, result, 0x80000000);
   return result;
 }
 
@@ -790,6 +882,7 @@ static uint32_t m68k_or_long(m68k_t *cpu, uint32_t in1, uint32_t in2)
 
 static uint8_t m68k_rol_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -808,6 +901,7 @@ static uint8_t m68k_rol_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 
 static uint16_t m68k_rol_word(m68k_t *cpu, uint16_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -826,6 +920,7 @@ static uint16_t m68k_rol_word(m68k_t *cpu, uint16_t input, uint8_t count)
 
 static uint32_t m68k_rol_long(m68k_t *cpu, uint32_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -846,6 +941,7 @@ static uint32_t m68k_rol_long(m68k_t *cpu, uint32_t input, uint8_t count)
 
 static uint8_t m68k_ror_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -864,6 +960,7 @@ static uint8_t m68k_ror_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 
 static uint16_t m68k_ror_word(m68k_t *cpu, uint16_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -882,6 +979,7 @@ static uint16_t m68k_ror_word(m68k_t *cpu, uint16_t input, uint8_t count)
 
 static uint32_t m68k_ror_long(m68k_t *cpu, uint32_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = 0;
   } else {
@@ -902,6 +1000,7 @@ static uint32_t m68k_ror_long(m68k_t *cpu, uint32_t input, uint8_t count)
 
 static uint8_t m68k_roxl_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = cpu->status.x;
   } else {
@@ -921,6 +1020,7 @@ static uint8_t m68k_roxl_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 
 static uint16_t m68k_roxl_word(m68k_t *cpu, uint16_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = cpu->status.x;
   } else {
@@ -940,6 +1040,7 @@ static uint16_t m68k_roxl_word(m68k_t *cpu, uint16_t input, uint8_t count)
 
 static uint32_t m68k_roxl_long(m68k_t *cpu, uint32_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = cpu->status.x;
   } else {
@@ -961,6 +1062,7 @@ static uint32_t m68k_roxl_long(m68k_t *cpu, uint32_t input, uint8_t count)
 
 static uint8_t m68k_roxr_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = cpu->status.x;
   } else {
@@ -980,6 +1082,7 @@ static uint8_t m68k_roxr_byte(m68k_t *cpu, uint8_t input, uint8_t count)
 
 static uint16_t m68k_roxr_word(m68k_t *cpu, uint16_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = cpu->status.x;
   } else {
@@ -999,6 +1102,7 @@ static uint16_t m68k_roxr_word(m68k_t *cpu, uint16_t input, uint8_t count)
 
 static uint32_t m68k_roxr_long(m68k_t *cpu, uint32_t input, uint8_t count)
 {
+  m68k_cc_flush(cpu);
   if (count == 0) {
     cpu->status.c = cpu->status.x;
   } else {
@@ -1021,12 +1125,8 @@ static uint32_t m68k_roxr_long(m68k_t *cpu, uint32_t input, uint8_t count)
 static uint8_t m68k_sub_byte(m68k_t *cpu, uint8_t sub, uint8_t min)
 {
   uint8_t result = min - sub;
-  cpu->status.n = result >> 7;
-  cpu->status.z = result == 0;
-  cpu->status.c = ((uint16_t)(min - sub) & 0x100) > 0;
-  cpu->status.v = (((min & 0x80) && !(sub & 0x80) && !(result & 0x80)) ||
-                  (!(min & 0x80) && (sub & 0x80) && (result & 0x80)));
-  cpu->status.x = cpu->status.c;
+  m68k_cc_set(cpu, M68K_CC_SUB, sub, min, result, 0x80);
+  cpu->status.x = sub > min;
   return result;
 }
 
@@ -1037,12 +1137,8 @@ static uint16_t m68k_sub_word(m68k_t *cpu, uint16_t sub, uint16_t min,
   if (skip_cc_set) {
     return result;
   }
-  cpu->status.n = result >> 15;
-  cpu->status.z = result == 0;
-  cpu->status.c = ((uint32_t)(min - sub) & 0x10000) > 0;
-  cpu->status.v = (((min & 0x8000) && !(sub & 0x8000) && !(result & 0x8000)) ||
-                  (!(min & 0x8000) && (sub & 0x8000) && (result & 0x8000)));
-  cpu->status.x = cpu->status.c;
+  m68k_cc_set(cpu, M68K_CC_SUB, sub, min, result, 0x8000);
+  cpu->status.x = sub > min;
   return result;
 }
 
@@ -1053,16 +1149,8 @@ static uint32_t m68k_sub_long(m68k_t *cpu, uint32_t sub, uint32_t min,
   if (skip_cc_set) {
     return result;
   }
-  cpu->status.n = result >> 31;
-  cpu->status.z = result == 0;
-  cpu->status.c = (((uint64_t)min - (uint64_t)sub) & 0x100000000) > 0;
-  cpu->status.v = (((min & 0x80000000) &&
-                   !(sub & 0x80000000) &&
-                !(result & 0x80000000)) ||
-                  (!(min & 0x80000000) &&
-                    (sub & 0x80000000) &&
-                 (result & 0x80000000)));
-  cpu->status.x = cpu->status.c;
+  m68k_cc_set(cpu, M68K_CC_SUB, sub, min, result, 0x80000000);
+  cpu->status.x = sub > min;
   return result;
 }
 
@@ -1088,6 +1176,7 @@ static uint32_t m68k_neg_long(m68k_t *cpu, uint32_t input)
 static uint8_t m68k_subx_byte(m68k_t *cpu, uint8_t sub, uint8_t min)
 {
   uint8_t result = (min - sub) - cpu->status.x;
+  m68k_cc_flush(cpu);
   cpu->status.n = result >> 7;
   if (result != 0) {
     cpu->status.z = 0;
@@ -1102,6 +1191,7 @@ static uint8_t m68k_subx_byte(m68k_t *cpu, uint8_t sub, uint8_t min)
 static uint16_t m68k_subx_word(m68k_t *cpu, uint16_t sub, uint16_t min)
 {
   uint16_t result = (min - sub) - cpu->status.x;
+  m68k_cc_flush(cpu);
   cpu->status.n = result >> 15;
   if (result != 0) {
     cpu->status.z = 0;
@@ -1116,6 +1206,7 @@ static uint16_t m68k_subx_word(m68k_t *cpu, uint16_t sub, uint16_t min)
 static uint32_t m68k_subx_long(m68k_t *cpu, uint32_t sub, uint32_t min)
 {
   uint32_t result = (min - sub) - cpu->status.x;
+  m68k_cc_flush(cpu);
   cpu->status.n = result >> 31;
   if (result != 0) {
     cpu->status.z = 0;
@@ -1137,6 +1228,7 @@ static uint32_t m68k_subx_long(m68k_t *cpu, uint32_t sub, uint32_t min)
 static uint8_t m68k_sub_bcd(m68k_t *cpu, uint8_t sub, uint8_t min)
 {
   uint16_t result = ((min & 0x0F) - (sub & 0x0F)) - cpu->status.x;
+  m68k_cc_flush(cpu);
   if (result > 0xF) {
     result += (min & 0xF0) - (sub & 0xF0);
     if (result > 0xFF) {
@@ -1169,129 +1261,172 @@ static uint8_t m68k_sub_bcd(m68k_t *cpu, uint8_t sub, uint8_t min)
 
 
 
-static void m68k_src_set(m68k_t *cpu, mem_t *mem,
-  uint8_t reg, uint8_t mode, int width)
+/* Extension words of an effective address, turned into a value that does
+   not depend on any register. Cached blocks keep them per instruction, so
+   replay skips fetching and decoding them again. */
+static const m68k_operand_t *m68k_operand_fetch(m68k_t *cpu, mem_t *mem,
+  int slot, uint8_t reg, uint8_t mode, int width, m68k_operand_t *operand)
 {
+  m68k_core_t *core = M68K_CORE(cpu);
+  m68k_operand_t *cached;
+  uint16_t key = (width << 6) | (mode << 3) | reg;
+  uint32_t pc = cpu->pc;
   uint16_t ext_word;
+
+#ifndef CPU_TRACE /* The trace needs every extension word fetched. */
+  if (core->block_replay != NULL) {
+    cached = &core->block_replay->operand[core->block_insn][slot];
+    if (cached->words > 0 && cached->key == key) {
+      cpu->pc += cached->words * 2;
+      cpu->opcode = cached->ext_word;
+      return cached;
+    }
+  }
+#endif /* CPU_TRACE */
+
+  if (mode == EA_MODE_AR_DISP_16) { /* (d16,An) */
+    operand->value = (int16_t)m68k_fetch(cpu, mem);
+
+  } else if (mode == EA_MODE_AR_DISP_8) { /* (d8,An,Xn) */
+    operand->value = (int8_t)(m68k_fetch(cpu, mem) & 0xFF);
+
+  } else {
+    switch (reg) {
+    case EA_MODE_EXT_ABS_WORD: /* (xxx).W */
+      operand->value = (int16_t)m68k_fetch(cpu, mem);
+      break;
+
+    case EA_MODE_EXT_ABS_LONG: /* (xxx).L */
+      operand->value = (m68k_fetch(cpu, mem) << 16);
+      operand->value += m68k_fetch(cpu, mem);
+      break;
+
+    case EA_MODE_EXT_PC_DISP_16: /* (d16,PC) */
+      ext_word = m68k_fetch(cpu, mem);
+      operand->value = cpu->pc - 2;
+      operand->value += (int16_t)(ext_word & 0xFFFF);
+      break;
+
+    case EA_MODE_EXT_PC_DISP_8: /* (d8,PC,Xn) */
+      ext_word = m68k_fetch(cpu, mem);
+      operand->value = cpu->pc - 2;
+      operand->value += (int8_t)(ext_word & 0xFF);
+      break;
+
+    case EA_MODE_EXT_IMMEDIATE: /* #<data> */
+      if (width == 4) {
+        ext_word = m68k_fetch(cpu, mem);
+        operand->value = (ext_word & 0xFFFF) << 16;
+        ext_word = m68k_fetch(cpu, mem);
+        operand->value |= ext_word & 0xFFFF;
+      } else {
+        ext_word = m68k_fetch(cpu, mem);
+        operand->value = ext_word;
+      }
+      break;
+
+    default:
+      /* Unhandled effective address. */
+      m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
+      break;
+    }
+  }
+
+  operand->key = key;
+  operand->ext_word = cpu->opcode; /* Last one fetched. */
+  operand->words = (cpu->pc - pc) >> 1;
+  if (core->block_record != NULL) {
+    cached = &core->block_record->operand[core->block_insn][slot];
+    *cached = *operand;
+  }
+  return operand;
+}
+
+
+
+static void m68k_ea_set(m68k_t *cpu, mem_t *mem, m68k_ea_t *ea, int slot,
+  uint8_t reg, uint8_t mode, int width)
+{
+  const m68k_operand_t *operand;
+  m68k_operand_t decoded;
   uint32_t address;
 
-  cpu->src.program_space = false;
+  ea->program_space = false;
 
   switch (mode) {
   case EA_MODE_DR_DIRECT: /* Dn */
-    m68k_trace_op_src("D%d", reg);
-    cpu->src.l = M68K_LOCATION_DR;
-    cpu->src.n = reg;
+    ea->l = M68K_LOCATION_DR;
+    ea->n = reg;
     break;
 
   case EA_MODE_AR_DIRECT: /* An */
-    m68k_trace_op_src("A%d", reg);
-    cpu->src.l = M68K_LOCATION_AR;
-    cpu->src.n = reg;
+    ea->l = M68K_LOCATION_AR;
+    ea->n = reg;
     break;
 
   case EA_MODE_AR_INDIRECT: /* (An) */
-    m68k_trace_op_src("(A%d)", reg);
     address = m68k_address_reg_value(cpu, reg);
-    cpu->src.l = M68K_LOCATION_MEM;
-    cpu->src.n = address;
+    ea->l = M68K_LOCATION_MEM;
+    ea->n = address;
     break;
 
   case EA_MODE_AR_POST_INC: /* (An)+ */
-    m68k_trace_op_src("(A%d)+", reg);
     address = m68k_address_reg_value(cpu, reg);
-    cpu->src.l = M68K_LOCATION_MEM;
-    cpu->src.n = address;
+    ea->l = M68K_LOCATION_MEM;
+    ea->n = address;
     m68k_address_reg_inc(cpu, reg, width);
     break;
 
   case EA_MODE_AR_PRE_DEC: /* -(An) */
-    m68k_trace_op_src("-(A%d)", reg);
     m68k_address_reg_dec(cpu, reg, width);
     address = m68k_address_reg_value(cpu, reg);
-    cpu->src.l = M68K_LOCATION_MEM;
-    cpu->src.n = address;
+    ea->l = M68K_LOCATION_MEM;
+    ea->n = address;
     break;
 
   case EA_MODE_AR_DISP_16: /* (d16,An) */
-    m68k_trace_op_src("(d16, A%d)", reg);
-    ext_word = m68k_fetch(cpu, mem);
+    operand = m68k_operand_fetch(cpu, mem, slot, reg, mode, width, &decoded);
     address = m68k_address_reg_value(cpu, reg);
-    address += (int16_t)(ext_word & 0xFFFF);
-    cpu->src.l = M68K_LOCATION_MEM;
-    cpu->src.n = address;
+    address += operand->value;
+    ea->l = M68K_LOCATION_MEM;
+    ea->n = address;
     break;
 
   case EA_MODE_AR_DISP_8: /* (d8,An,Xn) */
-    m68k_trace_op_src("(d8, A%d, Xn)", reg);
-    ext_word = m68k_fetch(cpu, mem);
+    operand = m68k_operand_fetch(cpu, mem, slot, reg, mode, width, &decoded);
     address = m68k_address_reg_value(cpu, reg);
-    address += (int8_t)(ext_word & 0xFF);
-    address += m68k_ext_word_reg_value(cpu, ext_word);
-    cpu->src.l = M68K_LOCATION_MEM;
-    cpu->src.n = address;
+    address += operand->value;
+    address += m68k_ext_word_reg_value(cpu, operand->ext_word);
+    ea->l = M68K_LOCATION_MEM;
+    ea->n = address;
     break;
 
   case EA_MODE_EXT:
+    operand = m68k_operand_fetch(cpu, mem, slot, reg, mode, width, &decoded);
     switch (reg) {
     case EA_MODE_EXT_ABS_WORD: /* (xxx).W */
-      address = (int16_t)m68k_fetch(cpu, mem);
-      m68k_trace_op_src("($%08x).W", address);
-      cpu->src.l = M68K_LOCATION_MEM;
-      cpu->src.n = address;
-      break;
-
     case EA_MODE_EXT_ABS_LONG: /* (xxx).L */
-      address = (m68k_fetch(cpu, mem) << 16);
-      address += m68k_fetch(cpu, mem);
-      m68k_trace_op_src("($%08x).L", address);
-      cpu->src.l = M68K_LOCATION_MEM;
-      cpu->src.n = address;
+      ea->l = M68K_LOCATION_MEM;
+      ea->n = operand->value;
       break;
 
     case EA_MODE_EXT_PC_DISP_16: /* (d16,PC) */
-      m68k_trace_op_src("(d16, PC)");
-      ext_word = m68k_fetch(cpu, mem);
-      address = cpu->pc - 2;
-      address += (int16_t)(ext_word & 0xFFFF);
-      cpu->src.l = M68K_LOCATION_MEM;
-      cpu->src.n = address;
-      cpu->src.program_space = true;
+      ea->l = M68K_LOCATION_MEM;
+      ea->n = operand->value;
+      ea->program_space = true;
       break;
 
     case EA_MODE_EXT_PC_DISP_8: /* (d8,PC,Xn) */
-      m68k_trace_op_src("(d8, PC, Xn)");
-      ext_word = m68k_fetch(cpu, mem);
-      address = cpu->pc - 2;
-      address += (int8_t)(ext_word & 0xFF);
-      address += m68k_ext_word_reg_value(cpu, ext_word);
-      cpu->src.l = M68K_LOCATION_MEM;
-      cpu->src.n = address;
-      cpu->src.program_space = true;
-      break;
-
-    case EA_MODE_EXT_IMMEDIATE: /* #<data> */
-      cpu->src.l = M68K_LOCATION_IMM;
-      if (width == 4) {
-        ext_word = m68k_fetch(cpu, mem);
-        cpu->src.n = (ext_word & 0xFFFF) << 16;
-        ext_word = m68k_fetch(cpu, mem);
-        cpu->src.n |= ext_word & 0xFFFF;
-        m68k_trace_op_src("#$%08x", cpu->src.n);
-      } else {
-        ext_word = m68k_fetch(cpu, mem);
-        cpu->src.n = ext_word;
-        if (width == 2) {
-          m68k_trace_op_src("#$%04x", cpu->src.n);
-        } else {
-          m68k_trace_op_src("#$%02x", cpu->src.n & 0xFF);
-        }
-      }
+      address = operand->value;
+      address += m68k_ext_word_reg_value(cpu, operand->ext_word);
+      ea->l = M68K_LOCATION_MEM;
+      ea->n = address;
+      ea->program_space = true;
       break;
 
-    default:
-      /* Unhandled effective address source. */
-      m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
+    default: /* #<data> */
+      ea->l = M68K_LOCATION_IMM;
+      ea->n = operand->value;
       break;
     }
     break;
@@ -1300,6 +1435,14 @@ static void m68k_src_set(m68k_t *cpu, mem_t *mem,
 
 
 
+static void m68k_src_set(m68k_t *cpu, mem_t *mem,
+  uint8_t reg, uint8_t mode, int width)
+{
+  m68k_ea_set(cpu, mem, &cpu->src, 0, reg, mode, width);
+}
+
+
+
 static uint8_t m68k_src_read_byte(m68k_t *cpu, mem_t *mem)
 {
   uint8_t value = 0;
@@ -1403,130 +1546,7 @@ static uint32_t m68k_src_read_long(m68k_t *cpu, mem_t *mem)
 static void m68k_dst_set(m68k_t *cpu, mem_t *mem,
   uint8_t reg, uint8_t mode, int width)
 {
-  uint16_t ext_word;
-  uint32_t address;
-
-  cpu->dst.program_space = false;
-
-  switch (mode) {
-  case EA_MODE_DR_DIRECT: /* Dn */
-    m68k_trace_op_dst("D%d", reg);
-    cpu->dst.l = M68K_LOCATION_DR;
-    cpu->dst.n = reg;
-    break;
-
-  case EA_MODE_AR_DIRECT: /* An */
-    m68k_trace_op_dst("A%d", reg);
-    cpu->dst.l = M68K_LOCATION_AR;
-    cpu->dst.n = reg;
-    break;
-
-  case EA_MODE_AR_INDIRECT: /* (An) */
-    m68k_trace_op_dst("(A%d)", reg);
-    address = m68k_address_reg_value(cpu, reg);
-    cpu->dst.l = M68K_LOCATION_MEM;
-    cpu->dst.n = address;
-    break;
-
-  case EA_MODE_AR_POST_INC: /* (An)+ */
-    m68k_trace_op_dst("(A%d)+", reg);
-    address = m68k_address_reg_value(cpu, reg);
-    cpu->dst.l = M68K_LOCATION_MEM;
-    cpu->dst.n = address;
-    m68k_address_reg_inc(cpu, reg, width);
-    break;
-
-  case EA_MODE_AR_PRE_DEC: /* -(An) */
-    m68k_trace_op_dst("-(A%d)", reg);
-    m68k_address_reg_dec(cpu, reg, width);
-    address = m68k_address_reg_value(cpu, reg);
-    cpu->dst.l = M68K_LOCATION_MEM;
-    cpu->dst.n = address;
-    break;
-
-  case EA_MODE_AR_DISP_16: /* (d16,An) */
-    m68k_trace_op_dst("(d16, A%d)", reg);
-    ext_word = m68k_fetch(cpu, mem);
-    address = m68k_address_reg_value(cpu, reg);
-    address += (int16_t)(ext_word & 0xFFFF);
-    cpu->dst.l = M68K_LOCATION_MEM;
-    cpu->dst.n = address;
-    break;
-
-  case EA_MODE_AR_DISP_8: /* (d8,An,Xn) */
-    m68k_trace_op_dst("(d8, A%d, Xn)", reg);
-    ext_word = m68k_fetch(cpu, mem);
-    address = m68k_address_reg_value(cpu, reg);
-    address += (int8_t)(ext_word & 0xFF);
-    address += m68k_ext_word_reg_value(cpu, ext_word);
-    cpu->dst.l = M68K_LOCATION_MEM;
-    cpu->dst.n = address;
-    break;
-
-  case EA_MODE_EXT:
-    switch (reg) {
-    case EA_MODE_EXT_ABS_WORD: /* (xxx).W */
-      address = (int16_t)m68k_fetch(cpu, mem);
-      m68k_trace_op_dst("($%08x).W", address);
-      cpu->dst.l = M68K_LOCATION_MEM;
-      cpu->dst.n = address;
-      break;
-
-    case EA_MODE_EXT_ABS_LONG: /* (xxx).L */
-      address = (m68k_fetch(cpu, mem) << 16);
-      address += m68k_fetch(cpu, mem);
-      m68k_trace_op_dst("($%08x).L", address);
-      cpu->dst.l = M68K_LOCATION_MEM;
-      cpu->dst.n = address;
-      break;
-
-    case EA_MODE_EXT_PC_DISP_16: /* (d16,PC) */
-      m68k_trace_op_dst("(d16, PC)");
-      ext_word = m68k_fetch(cpu, mem);
-      address = cpu->pc - 2;
-      address += (int16_t)(ext_word & 0xFFFF);
-      cpu->dst.l = M68K_LOCATION_MEM;
-      cpu->dst.n = address;
-      cpu->dst.program_space = true;
-      break;
-
-    case EA_MODE_EXT_PC_DISP_8: /* (d8,PC,Xn) */
-      m68k_trace_op_dst("(d8, PC, Xn)");
-      ext_word = m68k_fetch(cpu, mem);
-      address = cpu->pc - 2;
-      address += (int8_t)(ext_word & 0xFF);
-      address += m68k_ext_word_reg_value(cpu, ext_word);
-      cpu->dst.l = M68K_LOCATION_MEM;
-      cpu->dst.n = address;
-      cpu->dst.program_space = true;
-      break;
-
-    case EA_MODE_EXT_IMMEDIATE: /* #<data> */
-      cpu->dst.l = M68K_LOCATION_IMM;
-      if (width == 4) {
-        ext_word = m68k_fetch(cpu, mem);
-        cpu->dst.n = (ext_word & 0xFFFF) << 16;
-        ext_word = m68k_fetch(cpu, mem);
-        cpu->dst.n |= ext_word & 0xFFFF;
-        m68k_trace_op_dst("#$%08x", cpu->src.n);
-      } else {
-        ext_word = m68k_fetch(cpu, mem);
-        cpu->dst.n = ext_word;
-        if (width == 2) {
-          m68k_trace_op_dst("#$%04x", cpu->dst.n);
-        } else {
-          m68k_trace_op_dst("#$%02x", cpu->dst.n & 0xFF);
-        }
-      }
-      break;
-
-    default:
-      /* Unhandled effective address destination. */
-      m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-      break;
-    }
-    break;
-  }
+  m68k_ea_set(cpu, mem, &cpu->dst, 1, reg, mode, width);
 }
 
 
@@ -1716,10 +1736,7 @@ static void m68k_addx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("ADDX.B");
     if (rm) { /* -(Ay), -(Ax) */
-      m68k_trace_op_src("-(A%d)", reg_y);
-      m68k_trace_op_dst("-(A%d)", reg_x);
       m68k_address_reg_dec(cpu, reg_y, 1);
       address = m68k_address_reg_value(cpu, reg_y);
       src_value = mem_read_byte(mem, address);
@@ -1730,8 +1747,6 @@ static void m68k_addx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
       mem_write_byte(mem, address, dst_value);
 
     } else { /* Dy, Dx */
-      m68k_trace_op_src("D%d", reg_y);
-      m68k_trace_op_dst("D%d", reg_x);
       dst_value = m68k_addx_byte(cpu, cpu->d[reg_y], cpu->d[reg_x]);
       cpu->d[reg_x] &= ~0xFF;
       cpu->d[reg_x] |= dst_value;
@@ -1739,10 +1754,7 @@ static void m68k_addx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("ADDX.W");
     if (rm) { /* -(Ay), -(Ax) */
-      m68k_trace_op_src("-(A%d)", reg_y);
-      m68k_trace_op_dst("-(A%d)", reg_x);
       m68k_address_reg_dec(cpu, reg_y, 2);
       address = m68k_address_reg_value(cpu, reg_y);
       src_value = mem_read_word(mem, address, &error);
@@ -1759,8 +1771,6 @@ static void m68k_addx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
       mem_write_word(mem, address, dst_value, &error);
 
     } else { /* Dy, Dx */
-      m68k_trace_op_src("D%d", reg_y);
-      m68k_trace_op_dst("D%d", reg_x);
       dst_value = m68k_addx_word(cpu, cpu->d[reg_y], cpu->d[reg_x]);
       cpu->d[reg_x] &= ~0xFFFF;
       cpu->d[reg_x] |= dst_value;
@@ -1768,10 +1778,7 @@ static void m68k_addx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("ADDX.L");
     if (rm) { /* -(Ay), -(Ax) */
-      m68k_trace_op_src("-(A%d)", reg_y);
-      m68k_trace_op_dst("-(A%d)", reg_x);
       m68k_address_reg_dec(cpu, reg_y, 4);
       address = m68k_address_reg_value(cpu, reg_y);
       src_value = mem_read_long(mem, address, &error);
@@ -1788,8 +1795,6 @@ static void m68k_addx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
       mem_write_long(mem, address, dst_value, &error);
 
     } else { /* Dy, Dx */
-      m68k_trace_op_src("D%d", reg_y);
-      m68k_trace_op_dst("D%d", reg_x);
       dst_value = m68k_addx_long(cpu, cpu->d[reg_y], cpu->d[reg_x]);
       cpu->d[reg_x] = dst_value;
     }
@@ -1814,8 +1819,6 @@ static void m68k_add(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (op_mode) {
   case 0b000: /* Byte, <ea> + Dn -> Dn */
-    m68k_trace_op_mnemonic("ADD.B");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 1);
     value = m68k_add_byte(cpu, m68k_src_read_byte(cpu, mem), cpu->d[reg]);
     cpu->d[reg] &= ~0xFF;
@@ -1823,8 +1826,6 @@ static void m68k_add(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b001: /* Word, <ea> + Dn -> Dn */
-    m68k_trace_op_mnemonic("ADD.W");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_add_word(cpu,
       m68k_src_read_word(cpu, mem), cpu->d[reg], false);
@@ -1833,8 +1834,6 @@ static void m68k_add(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b010: /* Long, <ea> + Dn -> Dn */
-    m68k_trace_op_mnemonic("ADD.L");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     value = m68k_add_long(cpu,
       m68k_src_read_long(cpu, mem), cpu->d[reg], false);
@@ -1842,8 +1841,6 @@ static void m68k_add(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b011: /* Word, <ea>, An */
-    m68k_trace_op_mnemonic("ADDA.W");
-    m68k_trace_op_dst("A%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_address_reg_value(cpu, reg);
     value = m68k_add_long(cpu,
@@ -1852,47 +1849,27 @@ static void m68k_add(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b100: /* Byte, Dn + <ea> -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_addx(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("ADD.B");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
-      m68k_dst_write_byte(cpu, mem,
-        m68k_add_byte(cpu, cpu->d[reg],
-          m68k_dst_read_byte(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
+    m68k_dst_write_byte(cpu, mem,
+      m68k_add_byte(cpu, cpu->d[reg],
+        m68k_dst_read_byte(cpu, mem)));
     break;
 
   case 0b101: /* Word, Dn + <ea> -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_addx(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("ADD.W");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
-      m68k_dst_write_word(cpu, mem,
-        m68k_add_word(cpu, cpu->d[reg],
-          m68k_dst_read_word(cpu, mem), false));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
+    m68k_dst_write_word(cpu, mem,
+      m68k_add_word(cpu, cpu->d[reg],
+        m68k_dst_read_word(cpu, mem), false));
     break;
 
   case 0b110: /* Long, Dn + <ea> -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_addx(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("ADD.L");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
-      m68k_dst_write_long(cpu, mem,
-        m68k_add_long(cpu, cpu->d[reg],
-          m68k_dst_read_long(cpu, mem), false));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
+    m68k_dst_write_long(cpu, mem,
+      m68k_add_long(cpu, cpu->d[reg],
+        m68k_dst_read_long(cpu, mem), false));
     break;
 
   case 0b111: /* Long, <ea>, An */
-    m68k_trace_op_mnemonic("ADDA.L");
-    m68k_trace_op_dst("A%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     value = m68k_address_reg_value(cpu, reg);
     value = m68k_add_long(cpu,
@@ -1913,9 +1890,7 @@ static void m68k_addi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("ADDI.B");
     value = m68k_fetch(cpu, mem) & 0xFF;
-    m68k_trace_op_src("#$%02x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_dst_write_byte(cpu, mem,
       m68k_add_byte(cpu, value,
@@ -1923,9 +1898,7 @@ static void m68k_addi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("ADDI.W");
     value = m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%04x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_dst_write_word(cpu, mem,
       m68k_add_word(cpu, value,
@@ -1933,10 +1906,8 @@ static void m68k_addi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("ADDI.L");
     value = m68k_fetch(cpu, mem) << 16;
     value |= m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%08x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_add_long(cpu, value,
@@ -1965,8 +1936,6 @@ static void m68k_addq(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("ADDQ.B");
-    m68k_trace_op_src("%d", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_dst_write_byte(cpu, mem,
       m68k_add_byte(cpu, value,
@@ -1974,8 +1943,6 @@ static void m68k_addq(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("ADDQ.W");
-    m68k_trace_op_src("%d", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_dst_write_word(cpu, mem,
       m68k_add_word(cpu, value,
@@ -1983,8 +1950,6 @@ static void m68k_addq(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("ADDQ.L");
-    m68k_trace_op_src("%d", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_add_long(cpu, value,
@@ -2004,11 +1969,7 @@ static void m68k_abcd(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t rm    = (opcode >> 3) & 0b1;
   uint8_t reg_x = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("ABCD");
-
   if (rm) { /* -(Ay), -(Ax) */
-    m68k_trace_op_src("-(A%d)", reg_y);
-    m68k_trace_op_dst("-(A%d)", reg_x);
     m68k_address_reg_dec(cpu, reg_y, 1);
     address = m68k_address_reg_value(cpu, reg_y);
     src_value = mem_read_byte(mem, address);
@@ -2019,8 +1980,6 @@ static void m68k_abcd(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     mem_write_byte(mem, address, dst_value);
 
   } else { /* Dy, Dx */
-    m68k_trace_op_src("D%d", reg_y);
-    m68k_trace_op_dst("D%d", reg_x);
     dst_value = m68k_add_bcd(cpu, cpu->d[reg_y], cpu->d[reg_x]);
     cpu->d[reg_x] &= ~0xFF;
     cpu->d[reg_x] |= dst_value;
@@ -2029,35 +1988,28 @@ static void m68k_abcd(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_exg(m68k_t *cpu, uint16_t opcode)
+static void m68k_exg(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint32_t temp;
   uint8_t reg_y  =  opcode       & 0b111;
   uint8_t opmode = (opcode >> 3) & 0b11111;
   uint8_t reg_x  = (opcode >> 9) & 0b111;
-
-  m68k_trace_op_mnemonic("EXG");
+  (void)mem;
 
   switch (opmode) {
   case 0b01000:
-    m68k_trace_op_src("D%d", reg_x);
-    m68k_trace_op_dst("D%d", reg_y);
     temp = cpu->d[reg_y];
     cpu->d[reg_y] = cpu->d[reg_x];
     cpu->d[reg_x] = temp;
     break;
 
   case 0b01001:
-    m68k_trace_op_src("A%d", reg_x);
-    m68k_trace_op_dst("A%d", reg_y);
     temp = m68k_address_reg_value(cpu, reg_y);
     m68k_address_reg_set_long(cpu, reg_y, m68k_address_reg_value(cpu, reg_x));
     m68k_address_reg_set_long(cpu, reg_x, temp);
     break;
 
   case 0b10001:
-    m68k_trace_op_src("D%d", reg_x);
-    m68k_trace_op_dst("A%d", reg_y);
     temp = cpu->d[reg_x];
     cpu->d[reg_x] = m68k_address_reg_value(cpu, reg_y);
     m68k_address_reg_set_long(cpu, reg_y, temp);
@@ -2073,8 +2025,8 @@ static void m68k_muls(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("MULS");
-  m68k_trace_op_dst("D%d", reg);
+  m68k_cc_flush(cpu);
+
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
   cpu->d[reg] = (int16_t)m68k_src_read_word(cpu, mem) *
                 (int16_t)(cpu->d[reg] & 0xFFFF);
@@ -2092,8 +2044,8 @@ static void m68k_mulu(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("MULU");
-  m68k_trace_op_dst("D%d", reg);
+  m68k_cc_flush(cpu);
+
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
   cpu->d[reg] = m68k_src_read_word(cpu, mem) * (cpu->d[reg] & 0xFFFF);
   cpu->status.n = cpu->d[reg] >> 31;
@@ -2114,8 +2066,6 @@ static void m68k_and(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (op_mode) {
   case 0b000: /* Byte, <ea> & Dn -> Dn */
-    m68k_trace_op_mnemonic("AND.B");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 1);
     value = m68k_and_byte(cpu, m68k_src_read_byte(cpu, mem), cpu->d[reg]);
     cpu->d[reg] &= ~0xFF;
@@ -2123,8 +2073,6 @@ static void m68k_and(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b001: /* Word, <ea> & Dn -> Dn */
-    m68k_trace_op_mnemonic("AND.W");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_and_word(cpu,
       m68k_src_read_word(cpu, mem), cpu->d[reg]);
@@ -2133,62 +2081,31 @@ static void m68k_and(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b010: /* Long, <ea> & Dn -> Dn */
-    m68k_trace_op_mnemonic("AND.L");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     value = m68k_and_long(cpu,
       m68k_src_read_long(cpu, mem), cpu->d[reg]);
     cpu->d[reg] = value;
     break;
 
-  case 0b011:
-    m68k_mulu(cpu, mem, opcode);
-    break;
-
   case 0b100: /* Byte, Dn & <ea> -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_abcd(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("AND.B");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
-      m68k_dst_write_byte(cpu, mem,
-        m68k_and_byte(cpu, cpu->d[reg],
-          m68k_dst_read_byte(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
+    m68k_dst_write_byte(cpu, mem,
+      m68k_and_byte(cpu, cpu->d[reg],
+        m68k_dst_read_byte(cpu, mem)));
     break;
 
   case 0b101: /* Word, Dn & <ea> -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_exg(cpu, opcode);
-    } else {
-      m68k_trace_op_mnemonic("AND.W");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
-      m68k_dst_write_word(cpu, mem,
-        m68k_and_word(cpu, cpu->d[reg],
-          m68k_dst_read_word(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
+    m68k_dst_write_word(cpu, mem,
+      m68k_and_word(cpu, cpu->d[reg],
+        m68k_dst_read_word(cpu, mem)));
     break;
 
   case 0b110: /* Long, Dn & <ea> -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT) {
-      /* Unhandled AND sub-instruction. */
-      m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-    } else if (ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_exg(cpu, opcode);
-    } else {
-      m68k_trace_op_mnemonic("AND.L");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
-      m68k_dst_write_long(cpu, mem,
-        m68k_and_long(cpu, cpu->d[reg],
-          m68k_dst_read_long(cpu, mem)));
-    }
-    break;
-
-  case 0b111:
-    m68k_muls(cpu, mem, opcode);
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
+    m68k_dst_write_long(cpu, mem,
+      m68k_and_long(cpu, cpu->d[reg],
+        m68k_dst_read_long(cpu, mem)));
     break;
   }
 }
@@ -2202,13 +2119,12 @@ static void m68k_andi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t size    = (opcode >> 6) & 0b11;
 
+  m68k_cc_flush(cpu);
+
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("ANDI.B");
     value = m68k_fetch(cpu, mem) & 0xFF;
-    m68k_trace_op_src("#$%02x", value);
     if ((ea_mode == EA_MODE_EXT) && (ea_reg == EA_MODE_EXT_IMMEDIATE)) {
-      m68k_trace_op_dst("CCR");
       cpu->sr &= (0xFF00 + value);
     } else {
       m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
@@ -2219,11 +2135,8 @@ static void m68k_andi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("ANDI.W");
     value = m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%04x", value);
     if ((ea_mode == EA_MODE_EXT) && (ea_reg == EA_MODE_EXT_IMMEDIATE)) {
-      m68k_trace_op_dst("SR");
       if (cpu->status.s) {
         cpu->sr &= value;
       } else {
@@ -2238,10 +2151,8 @@ static void m68k_andi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("ANDI.L");
     value = m68k_fetch(cpu, mem) << 16;
     value |= m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%08x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_and_long(cpu, value,
@@ -2257,29 +2168,25 @@ static void m68k_andi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_as_reg_byte(m68k_t *cpu, uint16_t opcode)
+static void m68k_as_reg_byte(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t value;
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ASL.B");
     value = m68k_asl_byte(cpu, cpu->d[reg] & 0xFF, count);
   } else {
-    m68k_trace_op_mnemonic("ASR.B");
     value = m68k_asr_byte(cpu, cpu->d[reg] & 0xFF, count);
   }
   cpu->d[reg] &= ~0xFF;
@@ -2288,29 +2195,25 @@ static void m68k_as_reg_byte(m68k_t *cpu, uint16_t opcode)
 
 
 
-static void m68k_as_reg_word(m68k_t *cpu, uint16_t opcode)
+static void m68k_as_reg_word(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint16_t value;
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ASL.W");
     value = m68k_asl_word(cpu, cpu->d[reg] & 0xFFFF, count);
   } else {
-    m68k_trace_op_mnemonic("ASR.W");
     value = m68k_asr_word(cpu, cpu->d[reg] & 0xFFFF, count);
   }
   cpu->d[reg] &= ~0xFFFF;
@@ -2319,28 +2222,24 @@ static void m68k_as_reg_word(m68k_t *cpu, uint16_t opcode)
 
 
 
-static void m68k_as_reg_long(m68k_t *cpu, uint16_t opcode)
+static void m68k_as_reg_long(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ASL.L");
     cpu->d[reg] = m68k_asl_long(cpu, cpu->d[reg], count);
   } else {
-    m68k_trace_op_mnemonic("ASR.L");
     cpu->d[reg] = m68k_asr_long(cpu, cpu->d[reg], count);
   }
 }
@@ -2355,12 +2254,10 @@ static void m68k_as_mem(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
   if (dr) {
-    m68k_trace_op_mnemonic("ASL.W");
     m68k_dst_write_word(cpu, mem,
       m68k_asl_word(cpu,
         m68k_dst_read_word(cpu, mem), 1));
   } else {
-    m68k_trace_op_mnemonic("ASR.W");
     m68k_dst_write_word(cpu, mem,
       m68k_asr_word(cpu,
         m68k_dst_read_word(cpu, mem), 1));
@@ -2377,6 +2274,8 @@ static void m68k_branch(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   int16_t disp = (int8_t)(opcode & 0xFF);
   uint8_t cond = (opcode >> 8) & 0b1111;
 
+  m68k_cc_flush(cpu);
+
   if (disp == 0) {
     disp = (int16_t)m68k_fetch(cpu, mem);
     address = cpu->pc + (disp - 2);
@@ -2385,93 +2284,78 @@ static void m68k_branch(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     address = cpu->pc + disp;
   }
 
-  m68k_trace_op_dst("$%08x", address);
-
   switch (cond) {
   case 0b0000:
-    m68k_trace_op_mnemonic("BRA");
     branch = true;
     break;
 
   case 0b0001:
-    m68k_trace_op_mnemonic("BSR");
     branch = true;
     m68k_stack_push(cpu, mem, cpu->pc % 0x10000);
     m68k_stack_push(cpu, mem, cpu->pc / 0x10000);
     break;
 
   case 0b0010:
-    m68k_trace_op_mnemonic("BHI");
     if (cpu->status.c == 0 && cpu->status.z == 0) {
       branch = true;
     }
     break;
 
   case 0b0011:
-    m68k_trace_op_mnemonic("BLS");
     if (cpu->status.c == 1 || cpu->status.z == 1) {
       branch = true;
     }
     break;
 
   case 0b0100:
-    m68k_trace_op_mnemonic("BCC");
     if (cpu->status.c == 0) {
       branch = true;
     }
     break;
 
   case 0b0101:
-    m68k_trace_op_mnemonic("BCS");
     if (cpu->status.c == 1) {
       branch = true;
     }
     break;
 
   case 0b0110:
-    m68k_trace_op_mnemonic("BNE");
     if (cpu->status.z == 0) {
       branch = true;
     }
     break;
 
   case 0b0111:
-    m68k_trace_op_mnemonic("BEQ");
     if (cpu->status.z == 1) {
       branch = true;
     }
     break;
 
   case 0b1000:
-    m68k_trace_op_mnemonic("BVC");
     if (cpu->status.v == 0) {
       branch = true;
     }
     break;
 
   case 0b1001:
-    m68k_trace_op_mnemonic("BVS");
     if (cpu->status.v == 1) {
       branch = true;
     }
     break;
 
   case 0b1010:
-    m68k_trace_op_mnemonic("BPL");
     if (cpu->status.n == 0) {
       branch = true;
     }
     break;
 
   case 0b1011:
-    m68k_trace_op_mnemonic("BMI");
     if (cpu->status.n == 1) {
       branch = true;
     }
     break;
 
   case 0b1100:
-    m68k_trace_op_mnemonic("BGE");
     if ((cpu->status.n == 1 && cpu->status.v == 1) ||
         (cpu->status.n == 0 && cpu->status.v == 0))
     {
@@ -2480,7 +2364,6 @@ static void m68k_branch(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1101:
-    m68k_trace_op_mnemonic("BLT");
     if ((cpu->status.n == 0 && cpu->status.v == 1) ||
         (cpu->status.n == 1 && cpu->status.v == 0))
     {
@@ -2489,7 +2372,6 @@ static void m68k_branch(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1110:
-    m68k_trace_op_mnemonic("BGT");
     if ((cpu->status.n == 0 && cpu->status.v == 0 && cpu->status.z == 0) ||
         (cpu->status.n == 1 && cpu->status.v == 1 && cpu->status.z == 0))
     {
@@ -2498,7 +2380,6 @@ static void m68k_branch(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1111:
-    m68k_trace_op_mnemonic("BLE");
     if ((cpu->status.z == 1) ||
         (cpu->status.n == 1 && cpu->status.v == 0) ||
         (cpu->status.n == 0 && cpu->status.v == 1))
@@ -2534,9 +2415,9 @@ static void m68k_bchg_imm(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("BCHG");
+  m68k_cc_flush(cpu);
+
   bit_no = m68k_fetch(cpu, mem);
-  m68k_trace_op_src("#%d", bit_no);
   if (ea_mode == EA_MODE_DR_DIRECT) {
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 8);
     bit_no %= 32;
@@ -2574,8 +2455,8 @@ static void m68k_bchg_reg(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("BCHG");
-  m68k_trace_op_src("D%d", reg);
+  m68k_cc_flush(cpu);
+
   bit_no = cpu->d[reg];
   if (ea_mode == EA_MODE_DR_DIRECT) {
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 8);
@@ -2613,9 +2494,9 @@ static void m68k_bclr_imm(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("BCLR");
+  m68k_cc_flush(cpu);
+
   bit_no = m68k_fetch(cpu, mem);
-  m68k_trace_op_src("#%d", bit_no);
   if (ea_mode == EA_MODE_DR_DIRECT) {
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 8);
     bit_no %= 32;
@@ -2651,8 +2532,8 @@ static void m68k_bclr_reg(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("BCLR");
-  m68k_trace_op_src("D%d", reg);
+  m68k_cc_flush(cpu);
+
   bit_no = cpu->d[reg];
   if (ea_mode == EA_MODE_DR_DIRECT) {
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 8);
@@ -2688,9 +2569,9 @@ static void m68k_bset_imm(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("BSET");
+  m68k_cc_flush(cpu);
+
   bit_no = m68k_fetch(cpu, mem);
-  m68k_trace_op_src("#%d", bit_no);
   if (ea_mode == EA_MODE_DR_DIRECT) {
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 8);
     bit_no %= 32;
@@ -2726,8 +2607,8 @@ static void m68k_bset_reg(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("BSET");
-  m68k_trace_op_src("D%d", reg);
+  m68k_cc_flush(cpu);
+
   bit_no = cpu->d[reg];
   if (ea_mode == EA_MODE_DR_DIRECT) {
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 8);
@@ -2762,9 +2643,9 @@ static void m68k_btst_imm(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("BTST");
+  m68k_cc_flush(cpu);
+
   bit_no = m68k_fetch(cpu, mem);
-  m68k_trace_op_src("#%d", bit_no);
   if (ea_mode == EA_MODE_DR_DIRECT) {
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 8);
     bit_no %= 32;
@@ -2793,8 +2674,8 @@ static void m68k_btst_reg(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("BTST");
-  m68k_trace_op_src("D%d", reg);
+  m68k_cc_flush(cpu);
+
   bit_no = cpu->d[reg];
   if (ea_mode == EA_MODE_DR_DIRECT) {
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 8);
@@ -2824,8 +2705,8 @@ static void m68k_chk(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("CHK");
-  m68k_trace_op_dst("D%d", reg);
+  m68k_cc_flush(cpu);
+
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
   cpu->status.v = 0;
   cpu->status.c = 0;
@@ -2845,7 +2726,7 @@ static void m68k_chk(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     cpu->sr &= ~0x8000; /* Clear Trace Bit */
     cpu->sr |= 0x2000; /* Set Supervisor Bit */
 
-    longjmp(m68k_exception_jmp, 1);
+    longjmp(M68K_CORE(cpu)->exception_jmp, 1);
   }
 }
 
@@ -2859,30 +2740,24 @@ static void m68k_clr(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("CLR.B");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_dst_write_byte(cpu, mem, 0);
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("CLR.W");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     (void)m68k_dst_read_word(cpu, mem); /* Read access for exception. */
     m68k_dst_write_word(cpu, mem, 0);
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("CLR.L");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     (void)m68k_dst_read_long(cpu, mem); /* Read access for exception. */
     m68k_dst_write_long(cpu, mem, 0);
     break;
   }
 
-  cpu->status.n = 0;
-  cpu->status.z = 1;
-  cpu->status.v = 0;
-  cpu->status.c = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, 0, 0x80);
 }
 
 
@@ -2899,9 +2774,6 @@ static void m68k_cmpm(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("CMPM.B");
-    m68k_trace_op_src("(A%d)+", reg_y);
-    m68k_trace_op_dst("(A%d)+", reg_x);
     address = m68k_address_reg_value(cpu, reg_y);
     m68k_address_reg_inc(cpu, reg_y, 1);
     src_value = mem_read_byte(mem, address);
@@ -2912,9 +2784,6 @@ static void m68k_cmpm(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("CMPM.W");
-    m68k_trace_op_src("(A%d)+", reg_y);
-    m68k_trace_op_dst("(A%d)+", reg_x);
     address = m68k_address_reg_value(cpu, reg_y);
     m68k_address_reg_inc(cpu, reg_y, 2);
     src_value = mem_read_word(mem, address, &error);
@@ -2931,9 +2800,6 @@ static void m68k_cmpm(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("CMPM.L");
-    m68k_trace_op_src("(A%d)+", reg_y);
-    m68k_trace_op_dst("(A%d)+", reg_x);
     address = m68k_address_reg_value(cpu, reg_y);
     m68k_address_reg_inc(cpu, reg_y, 4);
     src_value = mem_read_long(mem, address, &error);
@@ -2968,76 +2834,48 @@ static void m68k_cmp_eor(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (op_mode) {
   case 0b000:
-    m68k_trace_op_mnemonic("CMP.B");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_cmp_byte(cpu, m68k_src_read_byte(cpu, mem), cpu->d[reg]);
     break;
 
   case 0b001:
-    m68k_trace_op_mnemonic("CMP.W");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_cmp_word(cpu, m68k_src_read_word(cpu, mem), cpu->d[reg]);
     break;
 
   case 0b010:
-    m68k_trace_op_mnemonic("CMP.L");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_cmp_long(cpu, m68k_src_read_long(cpu, mem), cpu->d[reg]);
     break;
 
   case 0b011:
-    m68k_trace_op_mnemonic("CMPA.W");
-    m68k_trace_op_dst("A%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_address_reg_value(cpu, reg);
     m68k_cmp_long(cpu, (int16_t)m68k_src_read_word(cpu, mem), value);
     break;
 
   case 0b100:
-    if (ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_cmpm(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("EOR.B");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
-      m68k_dst_write_byte(cpu, mem,
-        m68k_eor_byte(cpu, cpu->d[reg],
-          m68k_dst_read_byte(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
+    m68k_dst_write_byte(cpu, mem,
+      m68k_eor_byte(cpu, cpu->d[reg],
+        m68k_dst_read_byte(cpu, mem)));
     break;
 
   case 0b101:
-    if (ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_cmpm(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("EOR.W");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
-      m68k_dst_write_word(cpu, mem,
-        m68k_eor_word(cpu, cpu->d[reg],
-          m68k_dst_read_word(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
+    m68k_dst_write_word(cpu, mem,
+      m68k_eor_word(cpu, cpu->d[reg],
+        m68k_dst_read_word(cpu, mem)));
     break;
 
   case 0b110:
-    if (ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_cmpm(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("EOR.L");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
-      m68k_dst_write_long(cpu, mem,
-        m68k_eor_long(cpu, cpu->d[reg],
-          m68k_dst_read_long(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
+    m68k_dst_write_long(cpu, mem,
+      m68k_eor_long(cpu, cpu->d[reg],
+        m68k_dst_read_long(cpu, mem)));
     break;
 
   case 0b111:
-    m68k_trace_op_mnemonic("CMPA.L");
-    m68k_trace_op_dst("A%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     value = m68k_address_reg_value(cpu, reg);
     m68k_cmp_long(cpu, m68k_src_read_long(cpu, mem), value);
@@ -3056,26 +2894,20 @@ static void m68k_cmpi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("CMPI.B");
     value = m68k_fetch(cpu, mem) & 0xFF;
-    m68k_trace_op_src("#$%02x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_cmp_byte(cpu, value, m68k_dst_read_byte(cpu, mem));
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("CMPI.W");
     value = m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%04x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_cmp_word(cpu, value, m68k_dst_read_word(cpu, mem));
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("CMPI.L");
     value = m68k_fetch(cpu, mem) << 16;
     value |= m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%08x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_cmp_long(cpu, value, m68k_dst_read_long(cpu, mem));
     break;
@@ -3098,95 +2930,81 @@ static void m68k_dbcc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t reg  =  opcode       & 0b111;
   uint8_t cond = (opcode >> 8) & 0b1111;
 
+  m68k_cc_flush(cpu);
+
   disp = (int16_t)m68k_fetch(cpu, mem);
   address = cpu->pc + (disp - 2);
 
-  m68k_trace_op_src("D%d", reg);
-  m68k_trace_op_dst("$%08x", address);
-
   switch (cond) {
   case 0b0000:
-    m68k_trace_op_mnemonic("DT");
     result = true;
     break;
 
   case 0b0001:
-    m68k_trace_op_mnemonic("DF");
     result = false;
     break;
 
   case 0b0010:
-    m68k_trace_op_mnemonic("DHI");
     if (cpu->status.c == 0 && cpu->status.z == 0) {
       result = true;
     }
     break;
 
   case 0b0011:
-    m68k_trace_op_mnemonic("DLS");
     if (cpu->status.c == 1 || cpu->status.z == 1) {
       result = true;
     }
     break;
 
   case 0b0100:
-    m68k_trace_op_mnemonic("DCC");
     if (cpu->status.c == 0) {
       result = true;
     }
     break;
 
   case 0b0101:
-    m68k_trace_op_mnemonic("DCS");
     if (cpu->status.c == 1) {
       result = true;
     }
     break;
 
   case 0b0110:
-    m68k_trace_op_mnemonic("DNE");
     if (cpu->status.z == 0) {
       result = true;
     }
     break;
 
   case 0b0111:
-    m68k_trace_op_mnemonic("DEQ");
     if (cpu->status.z == 1) {
       result = true;
     }
     break;
 
   case 0b1000:
-    m68k_trace_op_mnemonic("DVC");
     if (cpu->status.v == 0) {
       result = true;
     }
     break;
 
   case 0b1001:
-    m68k_trace_op_mnemonic("DVS");
     if (cpu->status.v == 1) {
       result = true;
     }
     break;
 
   case 0b1010:
-    m68k_trace_op_mnemonic("DPL");
     if (cpu->status.n == 0) {
       result = true;
     }
     break;
 
   case 0b1011:
-    m68k_trace_op_mnemonic("DMI");
     if (cpu->status.n == 1) {
       result = true;
     }
     break;
 
   case 0b1100:
-    m68k_trace_op_mnemonic("DGE");
     if ((cpu->status.n == 1 && cpu->status.v == 1) ||
         (cpu->status.n == 0 && cpu->status.v == 0))
     {
@@ -3195,7 +3013,6 @@ static void m68k_dbcc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1101:
-    m68k_trace_op_mnemonic("DLT");
     if ((cpu->status.n == 0 && cpu->status.v == 1) ||
         (cpu->status.n == 1 && cpu->status.v == 0))
     {
@@ -3204,7 +3021,6 @@ static void m68k_dbcc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1110:
-    m68k_trace_op_mnemonic("DGT");
     if ((cpu->status.n == 0 && cpu->status.v == 0 && cpu->status.z == 0) ||
         (cpu->status.n == 1 && cpu->status.v == 1 && cpu->status.z == 0))
     {
@@ -3213,7 +3029,6 @@ static void m68k_dbcc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1111:
-    m68k_trace_op_mnemonic("DLE");
     if ((cpu->status.z == 1) ||
         (cpu->status.n == 1 && cpu->status.v == 0) ||
         (cpu->status.n == 0 && cpu->status.v == 1))
@@ -3251,13 +3066,12 @@ static void m68k_eori(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t size    = (opcode >> 6) & 0b11;
 
+  m68k_cc_flush(cpu);
+
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("EORI.B");
     value = m68k_fetch(cpu, mem) & 0xFF;
-    m68k_trace_op_src("#$%02x", value);
     if ((ea_mode == EA_MODE_EXT) && (ea_reg == EA_MODE_EXT_IMMEDIATE)) {
-      m68k_trace_op_dst("CCR");
       cpu->sr ^= (value & 0x1F);
     } else {
       m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
@@ -3268,11 +3082,8 @@ static void m68k_eori(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("EORI.W");
     value = m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%04x", value);
     if ((ea_mode == EA_MODE_EXT) && (ea_reg == EA_MODE_EXT_IMMEDIATE)) {
-      m68k_trace_op_dst("SR");
       if (cpu->status.s) {
         cpu->sr ^= m68k_sr_filter_bits(value);
       } else {
@@ -3287,10 +3098,8 @@ static void m68k_eori(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("EORI.L");
     value = m68k_fetch(cpu, mem) << 16;
     value |= m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%08x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_eor_long(cpu, value,
@@ -3306,17 +3115,17 @@ static void m68k_eori(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_ext(m68k_t *cpu, uint16_t opcode)
+static void m68k_ext(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint16_t word_value;
   uint8_t reg    =  opcode       & 0b111;
   uint8_t opmode = (opcode >> 6) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
+  m68k_cc_flush(cpu);
 
   switch (opmode) {
   case 0b010:
-    m68k_trace_op_mnemonic("EXT.W");
     word_value = (int8_t)cpu->d[reg];
     cpu->d[reg] &= ~0xFFFF;
     cpu->d[reg] |= word_value;
@@ -3325,7 +3134,6 @@ static void m68k_ext(m68k_t *cpu, uint16_t opcode)
     break;
 
   case 0b011:
-    m68k_trace_op_mnemonic("EXT.L");
     cpu->d[reg] = (int16_t)cpu->d[reg];
     cpu->status.n = cpu->d[reg] >> 31;
     cpu->status.z = cpu->d[reg] == 0;
@@ -3343,7 +3151,6 @@ static void m68k_jmp(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("JMP");
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
   if (cpu->src.n % 2 != 0) {
     m68k_address_error(cpu, mem, cpu->src.n, true, true);
@@ -3358,7 +3165,6 @@ static void m68k_jsr(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("JSR");
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
   if (cpu->src.n % 2 != 0) {
     m68k_address_error(cpu, mem, cpu->src.n, true, true);
@@ -3376,8 +3182,6 @@ static void m68k_lea(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("LEA");
-  m68k_trace_op_dst("A%d", reg);
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
   m68k_address_reg_set_long(cpu, reg, cpu->src.n);
 }
@@ -3390,43 +3194,36 @@ static void m68k_link(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   int16_t disp;
   uint8_t reg = opcode & 0b111;
 
-  m68k_trace_op_mnemonic("LINK");
-  m68k_trace_op_src("A%d", reg);
   value = m68k_address_reg_value(cpu, reg);
   m68k_stack_push(cpu, mem, value % 0x10000);
   m68k_stack_push(cpu, mem, value / 0x10000);
   m68k_address_reg_set_long(cpu, reg, m68k_address_reg_value(cpu, M68K_SP));
   disp = (int16_t)m68k_fetch(cpu, mem);
-  m68k_trace_op_dst("#%+hd", disp);
   m68k_address_reg_set_long(cpu, M68K_SP,
     m68k_address_reg_value(cpu, M68K_SP) + disp);
 }
 
 
 
-static void m68k_ls_reg_byte(m68k_t *cpu, uint16_t opcode)
+static void m68k_ls_reg_byte(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t value;
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("LSL.B");
     value = m68k_lsl_byte(cpu, cpu->d[reg] & 0xFF, count);
   } else {
-    m68k_trace_op_mnemonic("LSR.B");
     value = m68k_lsr_byte(cpu, cpu->d[reg] & 0xFF, count);
   }
   cpu->d[reg] &= ~0xFF;
@@ -3435,29 +3232,25 @@ static void m68k_ls_reg_byte(m68k_t *cpu, uint16_t opcode)
 
 
 
-static void m68k_ls_reg_word(m68k_t *cpu, uint16_t opcode)
+static void m68k_ls_reg_word(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint16_t value;
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("LSL.W");
     value = m68k_lsl_word(cpu, cpu->d[reg] & 0xFFFF, count);
   } else {
-    m68k_trace_op_mnemonic("LSR.W");
     value = m68k_lsr_word(cpu, cpu->d[reg] & 0xFFFF, count);
   }
   cpu->d[reg] &= ~0xFFFF;
@@ -3466,28 +3259,24 @@ static void m68k_ls_reg_word(m68k_t *cpu, uint16_t opcode)
 
 
 
-static void m68k_ls_reg_long(m68k_t *cpu, uint16_t opcode)
+static void m68k_ls_reg_long(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("LSL.L");
     cpu->d[reg] = m68k_lsl_long(cpu, cpu->d[reg], count);
   } else {
-    m68k_trace_op_mnemonic("LSR.L");
     cpu->d[reg] = m68k_lsr_long(cpu, cpu->d[reg], count);
   }
 }
@@ -3502,12 +3291,10 @@ static void m68k_ls_mem(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
   if (dr) {
-    m68k_trace_op_mnemonic("LSL.W");
     m68k_dst_write_word(cpu, mem,
       m68k_lsl_word(cpu,
         m68k_dst_read_word(cpu, mem), 1));
   } else {
-    m68k_trace_op_mnemonic("LSR.W");
     m68k_dst_write_word(cpu, mem,
       m68k_lsr_word(cpu,
         m68k_dst_read_word(cpu, mem), 1));
@@ -3522,8 +3309,8 @@ static void m68k_move_to_ccr(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("MOVE.W");
-  m68k_trace_op_dst("CCR");
+  m68k_cc_flush(cpu);
+
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
   value = m68k_src_read_word(cpu, mem);
   cpu->sr &= ~0x1F;
@@ -3538,8 +3325,8 @@ static void m68k_move_to_sr(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("MOVE.W");
-  m68k_trace_op_dst("SR");
+  m68k_cc_flush(cpu);
+
   if (cpu->status.s) {
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_src_read_word(cpu, mem);
@@ -3556,8 +3343,8 @@ static void m68k_move_from_sr(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("MOVE.W");
-  m68k_trace_op_src("SR");
+  m68k_cc_flush(cpu);
+
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
   (void)m68k_dst_read_word(cpu, mem); /* Read access for exception. */
   m68k_dst_write_word(cpu, mem, cpu->sr);
@@ -3569,9 +3356,6 @@ static void m68k_move_to_usp(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t reg = opcode & 0b111;
 
-  m68k_trace_op_mnemonic("MOVE.L");
-  m68k_trace_op_src("A%d", reg);
-  m68k_trace_op_dst("USP");
   if (cpu->status.s) {
     cpu->a[M68K_SP] = m68k_address_reg_value(cpu, reg);
   } else {
@@ -3585,9 +3369,6 @@ static void m68k_move_from_usp(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t reg = opcode & 0b111;
 
-  m68k_trace_op_mnemonic("MOVE.L");
-  m68k_trace_op_src("USP");
-  m68k_trace_op_dst("A%d", reg);
   if (cpu->status.s) {
     m68k_address_reg_set_long(cpu, reg, cpu->a[M68K_SP]);
   } else {
@@ -3605,13 +3386,9 @@ static void m68k_moveb(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t dst_mode = (opcode >> 6) & 0b111;
   uint8_t dst_reg  = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("MOVE.B");
   m68k_src_set(cpu, mem, src_reg, src_mode, 1);
   value = m68k_src_read_byte(cpu, mem);
-  cpu->status.n = value >> 7;
-  cpu->status.z = value == 0;
-  cpu->status.v = 0;
-  cpu->status.c = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, value, 0x80);
   m68k_dst_set(cpu, mem, dst_reg, dst_mode, 1);
   m68k_dst_write_byte(cpu, mem, value);
 }
@@ -3629,15 +3406,10 @@ static void m68k_movew(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   m68k_src_set(cpu, mem, src_reg, src_mode, 2);
   value = m68k_src_read_word(cpu, mem);
   if (dst_mode == EA_MODE_AR_DIRECT) {
-    m68k_trace_op_mnemonic("MOVEA.W");
     m68k_dst_set(cpu, mem, dst_reg, dst_mode, 2);
     m68k_dst_write_long(cpu, mem, (int16_t)value);
   } else {
-    m68k_trace_op_mnemonic("MOVE.W");
-    cpu->status.n = value >> 15;
-    cpu->status.z = value == 0;
-    cpu->status.v = 0;
-    cpu->status.c = 0;
+    m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, value, 0x8000);
     m68k_dst_set(cpu, mem, dst_reg, dst_mode, 2);
     m68k_dst_write_word(cpu, mem, value);
   }
@@ -3656,13 +3428,8 @@ static void m68k_movel(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   m68k_src_set(cpu, mem, src_reg, src_mode, 4);
   value = m68k_src_read_long(cpu, mem);
   if (dst_mode == EA_MODE_AR_DIRECT) {
-    m68k_trace_op_mnemonic("MOVEA.L");
   } else {
-    m68k_trace_op_mnemonic("MOVE.L");
-    cpu->status.n = value >> 31;
-    cpu->status.z = value == 0;
-    cpu->status.v = 0;
-    cpu->status.c = 0;
+    m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, value, 0x80000000);
   }
   m68k_dst_set(cpu, mem, dst_reg, dst_mode, 4);
   m68k_dst_write_long(cpu, mem, value);
@@ -3682,18 +3449,12 @@ static void m68k_movep(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (opmode) {
   case 0b100:
-    m68k_trace_op_mnemonic("MOVEP.W");
-    m68k_trace_op_src("(d16, A%d)", areg);
-    m68k_trace_op_dst("D%d", dreg);
     cpu->d[dreg] &= ~0xFFFF;
     cpu->d[dreg] |=  mem_read_byte(mem, address + 2);
     cpu->d[dreg] |= (mem_read_byte(mem, address) << 8);
     break;
 
   case 0b101:
-    m68k_trace_op_mnemonic("MOVEP.L");
-    m68k_trace_op_src("(d16, A%d)", areg);
-    m68k_trace_op_dst("D%d", dreg);
     cpu->d[dreg] =   mem_read_byte(mem, address + 6);
     cpu->d[dreg] |= (mem_read_byte(mem, address + 4) << 8);
     cpu->d[dreg] |= (mem_read_byte(mem, address + 2) << 16);
@@ -3701,17 +3462,11 @@ static void m68k_movep(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b110:
-    m68k_trace_op_mnemonic("MOVEP.W");
-    m68k_trace_op_src("D%d", dreg);
-    m68k_trace_op_dst("(d16, A%d)", areg);
     mem_write_byte(mem, address + 2, cpu->d[dreg]       & 0xFF);
     mem_write_byte(mem, address,    (cpu->d[dreg] >> 8) & 0xFF);
     break;
 
   case 0b111:
-    m68k_trace_op_mnemonic("MOVEP.L");
-    m68k_trace_op_src("D%d", dreg);
-    m68k_trace_op_dst("(d16, A%d)", areg);
     mem_write_byte(mem, address + 6,  cpu->d[dreg]        & 0xFF);
     mem_write_byte(mem, address + 4, (cpu->d[dreg] >> 8)  & 0xFF);
     mem_write_byte(mem, address + 2, (cpu->d[dreg] >> 16) & 0xFF);
@@ -3727,19 +3482,14 @@ static void m68k_movep(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_moveq(m68k_t *cpu, uint16_t opcode)
+static void m68k_moveq(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   int8_t value = (int8_t)(opcode & 0xFF);
   uint8_t reg = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_mnemonic("MOVEQ");
-  m68k_trace_op_src("%d", value);
-  m68k_trace_op_dst("D%d", reg);
   cpu->d[reg] = value;
-  cpu->status.n = value >> 7;
-  cpu->status.z = value == 0;
-  cpu->status.v = 0;
-  cpu->status.c = 0;
+  m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, cpu->d[reg], 0x80000000);
 }
 
 
@@ -3754,8 +3504,6 @@ static void m68k_movem_reg_to_mem_word(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   reg_list_mask = m68k_fetch(cpu, mem);
 
-  m68k_trace_op_mnemonic("MOVEM.W");
-  m68k_trace_op_src("*");
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
 
   if (ea_mode == EA_MODE_AR_PRE_DEC) {
@@ -3813,8 +3561,6 @@ static void m68k_movem_mem_to_reg_word(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   reg_list_mask = m68k_fetch(cpu, mem);
 
-  m68k_trace_op_mnemonic("MOVEM.W");
-  m68k_trace_op_dst("*");
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
 
   if (ea_mode == EA_MODE_AR_POST_INC) {
@@ -3856,8 +3602,6 @@ static void m68k_movem_reg_to_mem_long(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   reg_list_mask = m68k_fetch(cpu, mem);
 
-  m68k_trace_op_mnemonic("MOVEM.L");
-  m68k_trace_op_src("*");
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
 
   if (ea_mode == EA_MODE_AR_PRE_DEC) {
@@ -3915,8 +3659,6 @@ static void m68k_movem_mem_to_reg_long(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   reg_list_mask = m68k_fetch(cpu, mem);
 
-  m68k_trace_op_mnemonic("MOVEM.L");
-  m68k_trace_op_dst("*");
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
 
   if (ea_mode == EA_MODE_AR_POST_INC) {
@@ -3952,7 +3694,6 @@ static void m68k_nbcd(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("NBCD");
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
   m68k_dst_write_byte(cpu, mem,
     m68k_sub_bcd(cpu,
@@ -3969,7 +3710,6 @@ static void m68k_neg(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("NEG.B");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_dst_write_byte(cpu, mem,
       m68k_neg_byte(cpu,
@@ -3977,7 +3717,6 @@ static void m68k_neg(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("NEG.W");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_dst_write_word(cpu, mem,
       m68k_neg_word(cpu,
@@ -3985,7 +3724,6 @@ static void m68k_neg(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("NEG.L");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_neg_long(cpu,
@@ -4004,7 +3742,6 @@ static void m68k_negx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("NEGX.B");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_dst_write_byte(cpu, mem,
       m68k_subx_byte(cpu,
@@ -4012,7 +3749,6 @@ static void m68k_negx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("NEGX.W");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_dst_write_word(cpu, mem,
       m68k_subx_word(cpu,
@@ -4020,7 +3756,6 @@ static void m68k_negx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("NEGX.L");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_subx_long(cpu,
@@ -4031,9 +3766,11 @@ static void m68k_negx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_nop(void)
+static void m68k_nop(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
-  m68k_trace_op_mnemonic("NOP");
+  (void)cpu;
+  (void)mem;
+  (void)opcode;
 }
 
 
@@ -4046,7 +3783,6 @@ static void m68k_not(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("NOT.B");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_dst_write_byte(cpu, mem,
       m68k_not_byte(cpu,
@@ -4054,7 +3790,6 @@ static void m68k_not(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("NOT.W");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_dst_write_word(cpu, mem,
       m68k_not_word(cpu,
@@ -4062,7 +3797,6 @@ static void m68k_not(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("NOT.L");
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_not_long(cpu,
@@ -4082,11 +3816,7 @@ static void m68k_sbcd(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t rm    = (opcode >> 3) & 0b1;
   uint8_t reg_x = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("SBCD");
-
   if (rm) { /* -(Ay), -(Ax) */
-    m68k_trace_op_src("-(A%d)", reg_y);
-    m68k_trace_op_dst("-(A%d)", reg_x);
     m68k_address_reg_dec(cpu, reg_y, 1);
     address = m68k_address_reg_value(cpu, reg_y);
     src_value = mem_read_byte(mem, address);
@@ -4097,8 +3827,6 @@ static void m68k_sbcd(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     mem_write_byte(mem, address, dst_value);
 
   } else { /* Dy, Dx */
-    m68k_trace_op_src("D%d", reg_y);
-    m68k_trace_op_dst("D%d", reg_x);
     dst_value = m68k_sub_bcd(cpu, cpu->d[reg_y], cpu->d[reg_x]);
     cpu->d[reg_x] &= ~0xFF;
     cpu->d[reg_x] |= dst_value;
@@ -4116,8 +3844,8 @@ static void m68k_divs(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("DIVS");
-  m68k_trace_op_dst("D%d", reg);
+  m68k_cc_flush(cpu);
+
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
   dividend = (int32_t)cpu->d[reg];
   divisor = (int16_t)m68k_src_read_word(cpu, mem);
@@ -4151,8 +3879,8 @@ static void m68k_divu(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t reg     = (opcode >> 9) & 0b111;
 
-  m68k_trace_op_mnemonic("DIVU");
-  m68k_trace_op_dst("D%d", reg);
+  m68k_cc_flush(cpu);
+
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
   dividend = cpu->d[reg];
   divisor = m68k_src_read_word(cpu, mem);
@@ -4187,8 +3915,6 @@ static void m68k_or(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (op_mode) {
   case 0b000: /* Byte, <ea> & Dn -> Dn */
-    m68k_trace_op_mnemonic("OR.B");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 1);
     value = m68k_or_byte(cpu, m68k_src_read_byte(cpu, mem), cpu->d[reg]);
     cpu->d[reg] &= ~0xFF;
@@ -4196,8 +3922,6 @@ static void m68k_or(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b001: /* Word, <ea> & Dn -> Dn */
-    m68k_trace_op_mnemonic("OR.W");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_or_word(cpu,
       m68k_src_read_word(cpu, mem), cpu->d[reg]);
@@ -4206,61 +3930,31 @@ static void m68k_or(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b010: /* Long, <ea> & Dn -> Dn */
-    m68k_trace_op_mnemonic("OR.L");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     value = m68k_or_long(cpu,
       m68k_src_read_long(cpu, mem), cpu->d[reg]);
     cpu->d[reg] = value;
     break;
 
-  case 0b011:
-    m68k_divu(cpu, mem, opcode);
-    break;
-
   case 0b100: /* Byte, Dn & <ea> -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_sbcd(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("OR.B");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
-      m68k_dst_write_byte(cpu, mem,
-        m68k_or_byte(cpu, cpu->d[reg],
-          m68k_dst_read_byte(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
+    m68k_dst_write_byte(cpu, mem,
+      m68k_or_byte(cpu, cpu->d[reg],
+        m68k_dst_read_byte(cpu, mem)));
     break;
 
   case 0b101: /* Word, Dn & <ea> -> <ea> */
-    if (ea_mode == EA_MODE_AR_DIRECT) {
-      /* Unhandled OR sub-instruction. */
-      m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-    } else {
-      m68k_trace_op_mnemonic("OR.W");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
-      m68k_dst_write_word(cpu, mem,
-        m68k_or_word(cpu, cpu->d[reg],
-          m68k_dst_read_word(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
+    m68k_dst_write_word(cpu, mem,
+      m68k_or_word(cpu, cpu->d[reg],
+        m68k_dst_read_word(cpu, mem)));
     break;
 
   case 0b110: /* Long, Dn & <ea> -> <ea> */
-    if (ea_mode == EA_MODE_AR_DIRECT) {
-      /* Unhandled OR sub-instruction. */
-      m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-    } else {
-      m68k_trace_op_mnemonic("OR.L");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
-      m68k_dst_write_long(cpu, mem,
-        m68k_or_long(cpu, cpu->d[reg],
-          m68k_dst_read_long(cpu, mem)));
-    }
-    break;
-
-  case 0b111:
-    m68k_divs(cpu, mem, opcode);
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
+    m68k_dst_write_long(cpu, mem,
+      m68k_or_long(cpu, cpu->d[reg],
+        m68k_dst_read_long(cpu, mem)));
     break;
   }
 }
@@ -4274,13 +3968,12 @@ static void m68k_ori(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t size    = (opcode >> 6) & 0b11;
 
+  m68k_cc_flush(cpu);
+
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("ORI.B");
     value = m68k_fetch(cpu, mem) & 0xFF;
-    m68k_trace_op_src("#$%02x", value);
     if ((ea_mode == EA_MODE_EXT) && (ea_reg == EA_MODE_EXT_IMMEDIATE)) {
-      m68k_trace_op_dst("CCR");
       cpu->sr |= (value & 0x1F);
     } else {
       m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
@@ -4291,11 +3984,8 @@ static void m68k_ori(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("ORI.W");
     value = m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%04x", value);
     if ((ea_mode == EA_MODE_EXT) && (ea_reg == EA_MODE_EXT_IMMEDIATE)) {
-      m68k_trace_op_dst("SR");
       if (cpu->status.s) {
         cpu->sr |= m68k_sr_filter_bits(value);
       } else {
@@ -4310,10 +4000,8 @@ static void m68k_ori(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("ORI.L");
     value = m68k_fetch(cpu, mem) << 16;
     value |= m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%08x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_or_long(cpu, value,
@@ -4334,7 +4022,6 @@ static void m68k_pea(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("PEA");
   m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
   m68k_stack_push(cpu, mem, cpu->src.n % 0x10000);
   m68k_stack_push(cpu, mem, cpu->src.n / 0x10000);
@@ -4342,9 +4029,10 @@ static void m68k_pea(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_reset(m68k_t *cpu, mem_t *mem)
+static void m68k_reset(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
-  m68k_trace_op_mnemonic("RESET");
+  (void)opcode;
+
   if (cpu->status.s == false) {
     m68k_exception(cpu, mem, M68K_VECTOR_PRIVILEGE_VIOLATION);
   }
@@ -4352,29 +4040,25 @@ static void m68k_reset(m68k_t *cpu, mem_t *mem)
 
 
 
-static void m68k_ro_reg_byte(m68k_t *cpu, uint16_t opcode)
+static void m68k_ro_reg_byte(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t value;
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ROL.B");
     value = m68k_rol_byte(cpu, cpu->d[reg] & 0xFF, count);
   } else {
-    m68k_trace_op_mnemonic("ROR.B");
     value = m68k_ror_byte(cpu, cpu->d[reg] & 0xFF, count);
   }
   cpu->d[reg] &= ~0xFF;
@@ -4383,29 +4067,25 @@ static void m68k_ro_reg_byte(m68k_t *cpu, uint16_t opcode)
 
 
 
-static void m68k_ro_reg_word(m68k_t *cpu, uint16_t opcode)
+static void m68k_ro_reg_word(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint16_t value;
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ROL.W");
     value = m68k_rol_word(cpu, cpu->d[reg] & 0xFFFF, count);
   } else {
-    m68k_trace_op_mnemonic("ROR.W");
     value = m68k_ror_word(cpu, cpu->d[reg] & 0xFFFF, count);
   }
   cpu->d[reg] &= ~0xFFFF;
@@ -4414,28 +4094,24 @@ static void m68k_ro_reg_word(m68k_t *cpu, uint16_t opcode)
 
 
 
-static void m68k_ro_reg_long(m68k_t *cpu, uint16_t opcode)
+static void m68k_ro_reg_long(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ROL.L");
     cpu->d[reg] = m68k_rol_long(cpu, cpu->d[reg], count);
   } else {
-    m68k_trace_op_mnemonic("ROR.L");
     cpu->d[reg] = m68k_ror_long(cpu, cpu->d[reg], count);
   }
 }
@@ -4450,12 +4126,10 @@ static void m68k_ro_mem(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
   if (dr) {
-    m68k_trace_op_mnemonic("ROL.W");
     m68k_dst_write_word(cpu, mem,
       m68k_rol_word(cpu,
         m68k_dst_read_word(cpu, mem), 1));
   } else {
-    m68k_trace_op_mnemonic("ROR.W");
     m68k_dst_write_word(cpu, mem,
       m68k_ror_word(cpu,
         m68k_dst_read_word(cpu, mem), 1));
@@ -4464,29 +4138,25 @@ static void m68k_ro_mem(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_rox_reg_byte(m68k_t *cpu, uint16_t opcode)
+static void m68k_rox_reg_byte(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t value;
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ROXL.B");
     value = m68k_roxl_byte(cpu, cpu->d[reg] & 0xFF, count);
   } else {
-    m68k_trace_op_mnemonic("ROXR.B");
     value = m68k_roxr_byte(cpu, cpu->d[reg] & 0xFF, count);
   }
   cpu->d[reg] &= ~0xFF;
@@ -4495,29 +4165,25 @@ static void m68k_rox_reg_byte(m68k_t *cpu, uint16_t opcode)
 
 
 
-static void m68k_rox_reg_word(m68k_t *cpu, uint16_t opcode)
+static void m68k_rox_reg_word(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint16_t value;
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ROXL.W");
     value = m68k_roxl_word(cpu, cpu->d[reg] & 0xFFFF, count);
   } else {
-    m68k_trace_op_mnemonic("ROXR.W");
     value = m68k_roxr_word(cpu, cpu->d[reg] & 0xFFFF, count);
   }
   cpu->d[reg] &= ~0xFFFF;
@@ -4526,28 +4192,24 @@ static void m68k_rox_reg_word(m68k_t *cpu, uint16_t opcode)
 
 
 
-static void m68k_rox_reg_long(m68k_t *cpu, uint16_t opcode)
+static void m68k_rox_reg_long(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t reg   =  opcode       & 0b111;
   uint8_t ir    = (opcode >> 5) & 0b1;
   uint8_t dr    = (opcode >> 8) & 0b1;
   uint8_t count = (opcode >> 9) & 0b111;
+  (void)mem;
 
-  m68k_trace_op_dst("D%d", reg);
   if (ir) {
-    m68k_trace_op_src("D%d", count);
     count = cpu->d[count] % 64;
   } else {
-    m68k_trace_op_src("#%d", count);
     if (count == 0) {
       count = 8;
     }
   }
   if (dr) {
-    m68k_trace_op_mnemonic("ROXL.L");
     cpu->d[reg] = m68k_roxl_long(cpu, cpu->d[reg], count);
   } else {
-    m68k_trace_op_mnemonic("ROXR.L");
     cpu->d[reg] = m68k_roxr_long(cpu, cpu->d[reg], count);
   }
 }
@@ -4562,12 +4224,10 @@ static void m68k_rox_mem(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
   if (dr) {
-    m68k_trace_op_mnemonic("ROXL.W");
     m68k_dst_write_word(cpu, mem,
       m68k_roxl_word(cpu,
         m68k_dst_read_word(cpu, mem), 1));
   } else {
-    m68k_trace_op_mnemonic("ROXR.W");
     m68k_dst_write_word(cpu, mem,
       m68k_roxr_word(cpu,
         m68k_dst_read_word(cpu, mem), 1));
@@ -4576,13 +4236,15 @@ static void m68k_rox_mem(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_rte(m68k_t *cpu, mem_t *mem)
+static void m68k_rte(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint16_t new_sr;
   uint32_t old_pc;
   uint32_t bad_address;
+  (void)opcode;
+
+  m68k_cc_flush(cpu);
 
-  m68k_trace_op_mnemonic("RTE");
   old_pc = cpu->pc;
   if (cpu->status.s) {
     new_sr   = m68k_sr_filter_bits(m68k_stack_pop(cpu, mem));
@@ -4601,13 +4263,15 @@ static void m68k_rte(m68k_t *cpu, mem_t *mem)
 
 
 
-static void m68k_rtr(m68k_t *cpu, mem_t *mem)
+static void m68k_rtr(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint16_t value;
   uint32_t old_pc;
   uint32_t bad_address;
+  (void)opcode;
+
+  m68k_cc_flush(cpu);
 
-  m68k_trace_op_mnemonic("RTR");
   old_pc = cpu->pc;
   value = m68k_stack_pop(cpu, mem);
   cpu->sr &= ~0x1F;
@@ -4623,12 +4287,12 @@ static void m68k_rtr(m68k_t *cpu, mem_t *mem)
 
 
 
-static void m68k_rts(m68k_t *cpu, mem_t *mem)
+static void m68k_rts(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint32_t old_pc;
   uint32_t bad_address;
+  (void)opcode;
 
-  m68k_trace_op_mnemonic("RTS");
   old_pc = cpu->pc;
   cpu->pc  = m68k_stack_pop(cpu, mem) * 0x10000;
   cpu->pc += m68k_stack_pop(cpu, mem);
@@ -4648,91 +4312,80 @@ static void m68k_scc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_mode = (opcode >> 3) & 0b111;
   uint8_t cond    = (opcode >> 8) & 0b1111;
 
+  m68k_cc_flush(cpu);
+
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
 
   switch (cond) {
   case 0b0000:
-    m68k_trace_op_mnemonic("ST");
     result = true;
     break;
 
   case 0b0001:
-    m68k_trace_op_mnemonic("SF");
     result = false;
     break;
 
   case 0b0010:
-    m68k_trace_op_mnemonic("SHI");
     if (cpu->status.c == 0 && cpu->status.z == 0) {
       result = true;
     }
     break;
 
   case 0b0011:
-    m68k_trace_op_mnemonic("SLS");
     if (cpu->status.c == 1 || cpu->status.z == 1) {
       result = true;
     }
     break;
 
   case 0b0100:
-    m68k_trace_op_mnemonic("SCC");
     if (cpu->status.c == 0) {
       result = true;
     }
     break;
 
   case 0b0101:
-    m68k_trace_op_mnemonic("SCS");
     if (cpu->status.c == 1) {
       result = true;
     }
     break;
 
   case 0b0110:
-    m68k_trace_op_mnemonic("SNE");
     if (cpu->status.z == 0) {
       result = true;
     }
     break;
 
   case 0b0111:
-    m68k_trace_op_mnemonic("SEQ");
     if (cpu->status.z == 1) {
       result = true;
     }
     break;
 
   case 0b1000:
-    m68k_trace_op_mnemonic("SVC");
     if (cpu->status.v == 0) {
       result = true;
     }
     break;
 
   case 0b1001:
-    m68k_trace_op_mnemonic("SVS");
     if (cpu->status.v == 1) {
       result = true;
     }
     break;
 
   case 0b1010:
-    m68k_trace_op_mnemonic("SPL");
     if (cpu->status.n == 0) {
       result = true;
     }
     break;
 
   case 0b1011:
-    m68k_trace_op_mnemonic("SMI");
     if (cpu->status.n == 1) {
       result = true;
     }
     break;
 
   case 0b1100:
-    m68k_trace_op_mnemonic("SGE");
     if ((cpu->status.n == 1 && cpu->status.v == 1) ||
         (cpu->status.n == 0 && cpu->status.v == 0))
     {
@@ -4741,7 +4394,6 @@ static void m68k_scc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1101:
-    m68k_trace_op_mnemonic("SLT");
     if ((cpu->status.n == 0 && cpu->status.v == 1) ||
         (cpu->status.n == 1 && cpu->status.v == 0))
     {
@@ -4750,7 +4402,6 @@ static void m68k_scc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1110:
-    m68k_trace_op_mnemonic("SGT");
     if ((cpu->status.n == 0 && cpu->status.v == 0 && cpu->status.z == 0) ||
         (cpu->status.n == 1 && cpu->status.v == 1 && cpu->status.z == 0))
     {
@@ -4759,7 +4410,6 @@ static void m68k_scc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b1111:
-    m68k_trace_op_mnemonic("SLE");
     if ((cpu->status.z == 1) ||
         (cpu->status.n == 1 && cpu->status.v == 0) ||
         (cpu->status.n == 0 && cpu->status.v == 1))
@@ -4778,12 +4428,16 @@ static void m68k_scc(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_stop(m68k_t *cpu, mem_t *mem)
+static void m68k_stop(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
-  m68k_trace_op_mnemonic("STOP");
+  (void)opcode;
+
+  m68k_cc_flush(cpu);
+
   if (cpu->status.s) {
     cpu->sr = m68k_sr_filter_bits(m68k_fetch(cpu, mem));
     cpu->pc -= 4;
+    cpu->stop = M68K_RUN_STOP;
   } else {
     m68k_exception(cpu, mem, M68K_VECTOR_PRIVILEGE_VIOLATION);
   }
@@ -4804,10 +4458,7 @@ static void m68k_subx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("SUBX.B");
     if (rm) { /* -(Ay), -(Ax) */
-      m68k_trace_op_src("-(A%d)", reg_y);
-      m68k_trace_op_dst("-(A%d)", reg_x);
       m68k_address_reg_dec(cpu, reg_y, 1);
       address = m68k_address_reg_value(cpu, reg_y);
       src_value = mem_read_byte(mem, address);
@@ -4818,8 +4469,6 @@ static void m68k_subx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
       mem_write_byte(mem, address, dst_value);
 
     } else { /* Dy, Dx */
-      m68k_trace_op_src("D%d", reg_y);
-      m68k_trace_op_dst("D%d", reg_x);
       dst_value = m68k_subx_byte(cpu, cpu->d[reg_y], cpu->d[reg_x]);
       cpu->d[reg_x] &= ~0xFF;
       cpu->d[reg_x] |= dst_value;
@@ -4827,10 +4476,7 @@ static void m68k_subx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("SUBX.W");
     if (rm) { /* -(Ay), -(Ax) */
-      m68k_trace_op_src("-(A%d)", reg_y);
-      m68k_trace_op_dst("-(A%d)", reg_x);
       m68k_address_reg_dec(cpu, reg_y, 2);
       address = m68k_address_reg_value(cpu, reg_y);
       src_value = mem_read_word(mem, address, &error);
@@ -4847,8 +4493,6 @@ static void m68k_subx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
       mem_write_word(mem, address, dst_value, &error);
 
     } else { /* Dy, Dx */
-      m68k_trace_op_src("D%d", reg_y);
-      m68k_trace_op_dst("D%d", reg_x);
       dst_value = m68k_subx_word(cpu, cpu->d[reg_y], cpu->d[reg_x]);
       cpu->d[reg_x] &= ~0xFFFF;
       cpu->d[reg_x] |= dst_value;
@@ -4856,10 +4500,7 @@ static void m68k_subx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("SUBX.L");
     if (rm) { /* -(Ay), -(Ax) */
-      m68k_trace_op_src("-(A%d)", reg_y);
-      m68k_trace_op_dst("-(A%d)", reg_x);
       m68k_address_reg_dec(cpu, reg_y, 4);
       address = m68k_address_reg_value(cpu, reg_y);
       src_value = mem_read_long(mem, address, &error);
@@ -4876,8 +4517,6 @@ static void m68k_subx(m68k_t *cpu, mem_t *mem, uint16_t opcode)
       mem_write_long(mem, address, dst_value, &error);
 
     } else { /* Dy, Dx */
-      m68k_trace_op_src("D%d", reg_y);
-      m68k_trace_op_dst("D%d", reg_x);
       dst_value = m68k_subx_long(cpu, cpu->d[reg_y], cpu->d[reg_x]);
       cpu->d[reg_x] = dst_value;
     }
@@ -4902,8 +4541,6 @@ static void m68k_sub(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (op_mode) {
   case 0b000: /* Byte, Dn - <ea> -> Dn */
-    m68k_trace_op_mnemonic("SUB.B");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 1);
     value = m68k_sub_byte(cpu, m68k_src_read_byte(cpu, mem), cpu->d[reg]);
     cpu->d[reg] &= ~0xFF;
@@ -4911,8 +4548,6 @@ static void m68k_sub(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b001: /* Word, Dn - <ea> -> Dn */
-    m68k_trace_op_mnemonic("SUB.W");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_sub_word(cpu,
       m68k_src_read_word(cpu, mem), cpu->d[reg], false);
@@ -4921,8 +4556,6 @@ static void m68k_sub(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b010: /* Long, Dn - <ea> -> Dn */
-    m68k_trace_op_mnemonic("SUB.L");
-    m68k_trace_op_dst("D%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     value = m68k_sub_long(cpu,
       m68k_src_read_long(cpu, mem), cpu->d[reg], false);
@@ -4930,8 +4563,6 @@ static void m68k_sub(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b011: /* Word, <ea>, An */
-    m68k_trace_op_mnemonic("SUBA.W");
-    m68k_trace_op_dst("A%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_address_reg_value(cpu, reg);
     value = m68k_sub_long(cpu,
@@ -4940,47 +4571,27 @@ static void m68k_sub(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b100: /* Byte, <ea> - Dn -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_subx(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("SUB.B");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
-      m68k_dst_write_byte(cpu, mem,
-        m68k_sub_byte(cpu, cpu->d[reg],
-          m68k_dst_read_byte(cpu, mem)));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
+    m68k_dst_write_byte(cpu, mem,
+      m68k_sub_byte(cpu, cpu->d[reg],
+        m68k_dst_read_byte(cpu, mem)));
     break;
 
   case 0b101: /* Word, <ea> - Dn -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_subx(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("SUB.W");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
-      m68k_dst_write_word(cpu, mem,
-        m68k_sub_word(cpu, cpu->d[reg],
-          m68k_dst_read_word(cpu, mem), false));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
+    m68k_dst_write_word(cpu, mem,
+      m68k_sub_word(cpu, cpu->d[reg],
+        m68k_dst_read_word(cpu, mem), false));
     break;
 
   case 0b110: /* Long, <ea> - Dn -> <ea> */
-    if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
-      m68k_subx(cpu, mem, opcode);
-    } else {
-      m68k_trace_op_mnemonic("SUB.L");
-      m68k_trace_op_src("D%d", reg);
-      m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
-      m68k_dst_write_long(cpu, mem,
-        m68k_sub_long(cpu, cpu->d[reg],
-          m68k_dst_read_long(cpu, mem), false));
-    }
+    m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
+    m68k_dst_write_long(cpu, mem,
+      m68k_sub_long(cpu, cpu->d[reg],
+        m68k_dst_read_long(cpu, mem), false));
     break;
 
   case 0b111: /* Long, <ea>, An */
-    m68k_trace_op_mnemonic("SUBA.L");
-    m68k_trace_op_dst("A%d", reg);
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     value = m68k_address_reg_value(cpu, reg);
     value = m68k_sub_long(cpu,
@@ -5001,9 +4612,7 @@ static void m68k_subi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("SUBI.B");
     value = m68k_fetch(cpu, mem) & 0xFF;
-    m68k_trace_op_src("#$%02x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_dst_write_byte(cpu, mem,
       m68k_sub_byte(cpu, value,
@@ -5011,9 +4620,7 @@ static void m68k_subi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("SUBI.W");
     value = m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%04x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_dst_write_word(cpu, mem,
       m68k_sub_word(cpu, value,
@@ -5021,10 +4628,8 @@ static void m68k_subi(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("SUBI.L");
     value = m68k_fetch(cpu, mem) << 16;
     value |= m68k_fetch(cpu, mem);
-    m68k_trace_op_src("#$%08x", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_sub_long(cpu, value,
@@ -5053,8 +4658,6 @@ static void m68k_subq(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("SUBQ.B");
-    m68k_trace_op_src("%d", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
     m68k_dst_write_byte(cpu, mem,
       m68k_sub_byte(cpu, value,
@@ -5062,8 +4665,6 @@ static void m68k_subq(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("SUBQ.W");
-    m68k_trace_op_src("%d", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 2);
     m68k_dst_write_word(cpu, mem,
       m68k_sub_word(cpu, value,
@@ -5071,8 +4672,6 @@ static void m68k_subq(m68k_t *cpu, mem_t *mem, uint16_t opcode)
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("SUBQ.L");
-    m68k_trace_op_src("%d", value);
     m68k_dst_set(cpu, mem, ea_reg, ea_mode, 4);
     m68k_dst_write_long(cpu, mem,
       m68k_sub_long(cpu, value,
@@ -5083,13 +4682,14 @@ static void m68k_subq(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_swap(m68k_t *cpu, uint16_t opcode)
+static void m68k_swap(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint32_t value;
   uint8_t reg = opcode & 0b111;
+  (void)mem;
+
+  m68k_cc_flush(cpu);
 
-  m68k_trace_op_mnemonic("SWAP");
-  m68k_trace_op_dst("D%d", reg);
   value = cpu->d[reg] >> 16;
   value |= cpu->d[reg] << 16;
   cpu->d[reg] = value;
@@ -5107,7 +4707,8 @@ static void m68k_tas(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint8_t ea_reg  =  opcode       & 0b111;
   uint8_t ea_mode = (opcode >> 3) & 0b111;
 
-  m68k_trace_op_mnemonic("TAS");
+  m68k_cc_flush(cpu);
+
   m68k_dst_set(cpu, mem, ea_reg, ea_mode, 1);
   value = m68k_dst_read_byte(cpu, mem);
   cpu->status.n = value >> 7;
@@ -5123,10 +4724,10 @@ static void m68k_trap(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
   uint8_t vector = opcode & 0b1111;
 
-  m68k_trace_op_mnemonic("TRAP");
-  m68k_trace_op_dst("%d", vector);
   if (vector == 15 && cpu->trap_15_hook != NULL) {
-    (*cpu->trap_15_hook)(cpu->d);
+    if ((*cpu->trap_15_hook)(cpu->context, cpu->d)) {
+      cpu->stop = M68K_RUN_TRAP;
+    }
     return;
   }
   cpu->old_pc = cpu->pc; /* To be able to return from exception. */
@@ -5135,9 +4736,12 @@ static void m68k_trap(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-static void m68k_trapv(m68k_t *cpu, mem_t *mem)
+static void m68k_trapv(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
-  m68k_trace_op_mnemonic("TRAPV");
+  (void)opcode;
+
+  m68k_cc_flush(cpu);
+
   if (cpu->status.v) {
     cpu->old_pc = cpu->pc; /* To be able to return from exception. */
     m68k_exception(cpu, mem, M68K_VECTOR_TRAPV_INSTRUCTION);
@@ -5155,30 +4759,23 @@ static void m68k_tst(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
   switch (size) {
   case 0b00:
-    m68k_trace_op_mnemonic("TST.B");
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 1);
     value = m68k_src_read_byte(cpu, mem);
-    cpu->status.n = value >> 7;
+    m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, value, 0x80);
     break;
 
   case 0b01:
-    m68k_trace_op_mnemonic("TST.W");
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 2);
     value = m68k_src_read_word(cpu, mem);
-    cpu->status.n = value >> 15;
+    m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, value, 0x8000);
     break;
 
   case 0b10:
-    m68k_trace_op_mnemonic("TST.L");
     m68k_src_set(cpu, mem, ea_reg, ea_mode, 4);
     value = m68k_src_read_long(cpu, mem);
-    cpu->status.n = value >> 31;
+    m68k_cc_set(cpu, M68K_CC_LOGIC, 0, 0, value, 0x80000000);
     break;
   }
-
-  cpu->status.z = value == 0;
-  cpu->status.v = 0;
-  cpu->status.c = 0;
 }
 
 
@@ -5188,8 +4785,6 @@ static void m68k_unlk(m68k_t *cpu, mem_t *mem, uint16_t opcode)
   uint32_t value;
   uint8_t reg = opcode & 0b111;
 
-  m68k_trace_op_mnemonic("UNLK");
-  m68k_trace_op_dst("A%d", reg);
   value = m68k_address_reg_value(cpu, reg);
   if (value % 2 != 0) {
     m68k_address_error(cpu, mem, value, true, false);
@@ -5202,30 +4797,47 @@ static void m68k_unlk(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 
 
 
-void m68k_execute(m68k_t *cpu, mem_t *mem)
+static void m68k_illegal(m68k_t *cpu, mem_t *mem, uint16_t opcode)
 {
-  uint16_t opcode;
+  (void)opcode;
+
+  m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
+}
+
+
+
+static void m68k_line_a(m68k_t *cpu, mem_t *mem, uint16_t opcode)
+{
+  (void)opcode;
+
+  m68k_exception(cpu, mem, M68K_VECTOR_UNIMPLEMENTED_A_LINE_OPCODE);
+}
 
-  if (setjmp(m68k_exception_jmp) > 0) {
-    m68k_trace_end();
-    return;
-  }
 
-  m68k_trace_start(cpu);
-  cpu->old_pc = cpu->pc;
-  opcode = m68k_fetch(cpu, mem);
+
+static void m68k_line_f(m68k_t *cpu, mem_t *mem, uint16_t opcode)
+{
+  (void)opcode;
+
+  m68k_exception(cpu, mem, M68K_VECTOR_UNIMPLEMENTED_F_LINE_OPCODE);
+}
+
+
+
+static m68k_handler_t m68k_decode(uint16_t opcode)
+{
+  uint8_t ea_mode = (opcode >> 3) & 0b111;
+  uint8_t op_mode = (opcode >> 6) & 0b111;
 
   switch (opcode >> 12) {
   case 0b0000: /* Bit Manipulation/MOVEP/Immediate */
-    if (((opcode >> 3) & 0x7) == 0b001) {
-      m68k_movep(cpu, mem, opcode);
-      break;
+    if (ea_mode == EA_MODE_AR_DIRECT) {
+      return m68k_movep;
     }
 
     switch ((opcode >> 8) & 0xF) {
     case 0b0000:
-      m68k_ori(cpu, mem, opcode);
-      break;
+      return m68k_ori;
 
     case 0b0001:
     case 0b0011:
@@ -5237,94 +4849,66 @@ void m68k_execute(m68k_t *cpu, mem_t *mem)
     case 0b1111:
       switch ((opcode >> 6) & 0x3) {
       case 0b00:
-        m68k_btst_reg(cpu, mem, opcode);
-        break;
-
+        return m68k_btst_reg;
       case 0b01:
-        m68k_bchg_reg(cpu, mem, opcode);
-        break;
-
+        return m68k_bchg_reg;
       case 0b10:
-        m68k_bclr_reg(cpu, mem, opcode);
-        break;
-
-      case 0b11:
-        m68k_bset_reg(cpu, mem, opcode);
-        break;
+        return m68k_bclr_reg;
+      default:
+        return m68k_bset_reg;
       }
-      break;
 
     case 0b0010:
-      m68k_andi(cpu, mem, opcode);
-      break;
+      return m68k_andi;
 
     case 0b0100:
-      m68k_subi(cpu, mem, opcode);
-      break;
+      return m68k_subi;
 
     case 0b0110:
-      m68k_addi(cpu, mem, opcode);
-      break;
+      return m68k_addi;
 
     case 0b1000:
       switch ((opcode >> 6) & 0x3) {
       case 0b00:
-        m68k_btst_imm(cpu, mem, opcode);
-        break;
-
+        return m68k_btst_imm;
       case 0b01:
-        m68k_bchg_imm(cpu, mem, opcode);
-        break;
-
+        return m68k_bchg_imm;
       case 0b10:
-        m68k_bclr_imm(cpu, mem, opcode);
-        break;
-
-      case 0b11:
-        m68k_bset_imm(cpu, mem, opcode);
-        break;
+        return m68k_bclr_imm;
+      default:
+        return m68k_bset_imm;
       }
-      break;
 
     case 0b1010:
-      m68k_eori(cpu, mem, opcode);
-      break;
+      return m68k_eori;
 
     case 0b1100:
-      m68k_cmpi(cpu, mem, opcode);
-      break;
+      return m68k_cmpi;
 
     default:
-      m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-      break;
+      return m68k_illegal;
     }
-    break;
 
   case 0b0001: /* Move Byte */
-    m68k_moveb(cpu, mem, opcode);
-    break;
+    return m68k_moveb;
 
   case 0b0010: /* Move Long */
-    m68k_movel(cpu, mem, opcode);
-    break;
+    return m68k_movel;
 
   case 0b0011: /* Move Word */
-    m68k_movew(cpu, mem, opcode);
-    break;
+    return m68k_movew;
 
   case 0b0100: /* Miscellaneous */
     switch ((opcode >> 6) & 0x3F) {
     case 0b000000:
     case 0b000001:
     case 0b000010:
-      m68k_negx(cpu, mem, opcode);
-      break;
+      return m68k_negx;
 
     case 0b001000:
     case 0b001001:
     case 0b001010:
-      m68k_clr(cpu, mem, opcode);
-      break;
+      return m68k_clr;
 
     case 0b000110:
     case 0b001110:
@@ -5334,8 +4918,7 @@ void m68k_execute(m68k_t *cpu, mem_t *mem)
     case 0b101110:
     case 0b110110:
     case 0b111110:
-      m68k_chk(cpu, mem, opcode);
-      break;
+      return m68k_chk;
 
     case 0b000111:
     case 0b001111:
@@ -5345,322 +4928,696 @@ void m68k_execute(m68k_t *cpu, mem_t *mem)
     case 0b101111:
     case 0b110111:
     case 0b111111:
-      m68k_lea(cpu, mem, opcode);
-      break;
+      return m68k_lea;
 
     case 0b010000:
     case 0b010001:
     case 0b010010:
-      m68k_neg(cpu, mem, opcode);
-      break;
+      return m68k_neg;
 
     case 0b011000:
     case 0b011001:
     case 0b011010:
-      m68k_not(cpu, mem, opcode);
-      break;
+      return m68k_not;
 
     case 0b010011:
-      m68k_move_to_ccr(cpu, mem, opcode);
-      break;
+      return m68k_move_to_ccr;
 
     case 0b011011:
-      m68k_move_to_sr(cpu, mem, opcode);
-      break;
+      return m68k_move_to_sr;
 
     case 0b000011:
-      m68k_move_from_sr(cpu, mem, opcode);
-      break;
+      return m68k_move_from_sr;
 
     case 0b100000:
-      m68k_nbcd(cpu, mem, opcode);
-      break;
+      return m68k_nbcd;
 
     case 0b100001:
-      switch ((opcode >> 3) & 0x7) {
+      switch (ea_mode) {
       case 0b000:
-        m68k_swap(cpu, opcode);
-        break;
+        return m68k_swap;
 
       case 0b010:
       case 0b101:
       case 0b110:
       case 0b111:
-        m68k_pea(cpu, mem, opcode);
-        break;
+        return m68k_pea;
 
       default:
-        m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-        break;
+        return m68k_illegal;
       }
-      break;
 
     case 0b101000:
     case 0b101001:
     case 0b101010:
-      m68k_tst(cpu, mem, opcode);
-      break;
+      return m68k_tst;
 
     case 0b101011:
-      m68k_tas(cpu, mem, opcode);
-      break;
+      return m68k_tas;
 
     case 0b100010:
-      if (((opcode >> 3) & 0x7) == 0) {
-        m68k_ext(cpu, opcode);
+      if (ea_mode == EA_MODE_DR_DIRECT) {
+        return m68k_ext;
+      } else if (ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_illegal;
       } else {
-        m68k_movem_reg_to_mem_word(cpu, mem, opcode);
+        return m68k_movem_reg_to_mem_word;
       }
-      break;
 
     case 0b100011:
-      if (((opcode >> 3) & 0x7) == 0) {
-        m68k_ext(cpu, opcode);
+      if (ea_mode == EA_MODE_DR_DIRECT) {
+        return m68k_ext;
+      } else if (ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_illegal;
       } else {
-        m68k_movem_reg_to_mem_long(cpu, mem, opcode);
+        return m68k_movem_reg_to_mem_long;
       }
-      break;
 
     case 0b110010:
-      m68k_movem_mem_to_reg_word(cpu, mem, opcode);
-      break;
+      if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_illegal;
+      }
+      return m68k_movem_mem_to_reg_word;
 
     case 0b110011:
-      m68k_movem_mem_to_reg_long(cpu, mem, opcode);
-      break;
+      if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_illegal;
+      }
+      return m68k_movem_mem_to_reg_long;
 
     case 0b111011:
-      m68k_jmp(cpu, mem, opcode);
-      break;
+      return m68k_jmp;
 
     case 0b111010:
-      m68k_jsr(cpu, mem, opcode);
-      break;
+      return m68k_jsr;
 
     case 0b111001:
-      switch ((opcode >> 3) & 0x7) {
+      switch (ea_mode) {
       case 0b000:
       case 0b001:
-        m68k_trap(cpu, mem, opcode);
-        break;
+        return m68k_trap;
 
       case 0b010:
-        m68k_link(cpu, mem, opcode);
-        break;
+        return m68k_link;
 
       case 0b011:
-        m68k_unlk(cpu, mem, opcode);
-        break;
+        return m68k_unlk;
 
       case 0b100:
-        m68k_move_to_usp(cpu, mem, opcode);
-        break;
+        return m68k_move_to_usp;
 
       case 0b101:
-        m68k_move_from_usp(cpu, mem, opcode);
-        break;
+        return m68k_move_from_usp;
 
       case 0b110:
         switch (opcode & 0x7) {
         case 0b000:
-          m68k_reset(cpu, mem);
-          break;
-
+          return m68k_reset;
         case 0b001:
-          m68k_nop();
-          break;
-
+          return m68k_nop;
         case 0b010:
-          m68k_stop(cpu, mem);
-          break;
-
+          return m68k_stop;
         case 0b011:
-          m68k_rte(cpu, mem);
-          break;
-
+          return m68k_rte;
         case 0b101:
-          m68k_rts(cpu, mem);
-          break;
-
+          return m68k_rts;
         case 0b110:
-          m68k_trapv(cpu, mem);
-          break;
-
+          return m68k_trapv;
         case 0b111:
-          m68k_rtr(cpu, mem);
-          break;
-
+          return m68k_rtr;
         default:
-          panic("oneofthos");
-          m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-          break;
+          return m68k_illegal;
         }
-        break;
 
       default:
-        m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-        break;
+        return m68k_illegal;
       }
-      break;
 
     default:
-      m68k_exception(cpu, mem, M68K_VECTOR_ILLEGAL_INSTRUCTION);
-      break;
+      return m68k_illegal;
     }
-    break;
 
   case 0b0101: /* ADDQ/SUBQ/Scc/DBcc/TRAPcc */
-    switch ((opcode >> 6) & 0x3) {
-    case 0b00:
-    case 0b01:
-    case 0b10:
-      if ((opcode >> 8) & 1) {
-        m68k_subq(cpu, mem, opcode);
+    if (((opcode >> 6) & 0x3) == 0b11) {
+      if (ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_dbcc;
       } else {
-        m68k_addq(cpu, mem, opcode);
+        return m68k_scc;
       }
-      break;
-
-    case 0b11:
-      if (((opcode >> 3) & 0x7) == EA_MODE_AR_DIRECT) {
-        m68k_dbcc(cpu, mem, opcode);
-      } else {
-        m68k_scc(cpu, mem, opcode);
-      }
-      break;
+    } else if ((opcode >> 8) & 1) {
+      return m68k_subq;
+    } else {
+      return m68k_addq;
     }
-    break;
 
   case 0b0110: /* Bcc/BSR/BRA */
-    m68k_branch(cpu, mem, opcode);
-    break;
+    return m68k_branch;
 
   case 0b0111: /* MOVEQ */
-    m68k_moveq(cpu, opcode);
-    break;
+    return m68k_moveq;
 
   case 0b1000: /* OR/DIV/SBCD */
-    m68k_or(cpu, mem, opcode);
-    break;
+    switch (op_mode) {
+    case 0b011:
+      return m68k_divu;
+
+    case 0b111:
+      return m68k_divs;
+
+    case 0b100:
+      if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_sbcd;
+      }
+      return m68k_or;
+
+    case 0b101:
+    case 0b110:
+      if (ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_illegal;
+      }
+      return m68k_or;
+
+    default:
+      return m68k_or;
+    }
 
   case 0b1001: /* SUB/SUBX */
-    m68k_sub(cpu, mem, opcode);
-    break;
+    if (op_mode >= 0b100 && op_mode <= 0b110 &&
+      (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT)) {
+      return m68k_subx;
+    }
+    return m68k_sub;
 
   case 0b1010: /* (Unassigned, Reserved) */
-    m68k_exception(cpu, mem, M68K_VECTOR_UNIMPLEMENTED_A_LINE_OPCODE);
-    break;
+    return m68k_line_a;
 
   case 0b1011: /* CMP/EOR */
-    m68k_cmp_eor(cpu, mem, opcode);
-    break;
+    if (op_mode >= 0b100 && op_mode <= 0b110 &&
+      ea_mode == EA_MODE_AR_DIRECT) {
+      return m68k_cmpm;
+    }
+    return m68k_cmp_eor;
 
   case 0b1100: /* AND/MUL/ABCD/EXG */
-    m68k_and(cpu, mem, opcode);
-    break;
+    switch (op_mode) {
+    case 0b011:
+      return m68k_mulu;
+
+    case 0b111:
+      return m68k_muls;
+
+    case 0b100:
+      if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_abcd;
+      }
+      return m68k_and;
+
+    case 0b101:
+      if (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_exg;
+      }
+      return m68k_and;
+
+    case 0b110:
+      if (ea_mode == EA_MODE_DR_DIRECT) {
+        return m68k_illegal;
+      } else if (ea_mode == EA_MODE_AR_DIRECT) {
+        return m68k_exg;
+      }
+      return m68k_and;
+
+    default:
+      return m68k_and;
+    }
 
   case 0b1101: /* ADD/ADDX */
-    m68k_add(cpu, mem, opcode);
-    break;
+    if (op_mode >= 0b100 && op_mode <= 0b110 &&
+      (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT)) {
+      return m68k_addx;
+    }
+    return m68k_add;
 
   case 0b1110: /* Shift/Rotate/Bit Field */
-    switch ((opcode >> 6) & 0x3) {
-    case 0b00: /* Register, Byte */
-      switch ((opcode >> 3) & 0x3) {
+    if (((opcode >> 6) & 0x3) == 0b11) { /* Memory */
+      switch ((opcode >> 9) & 0x3) {
       case 0b00: /* Arithmetic Shift */
-        m68k_as_reg_byte(cpu, opcode);
-        break;
-
+        return m68k_as_mem;
       case 0b01: /* Logical Shift */
-        m68k_ls_reg_byte(cpu, opcode);
-        break;
-
+        return m68k_ls_mem;
       case 0b10: /* Rotate with Extend */
-        m68k_rox_reg_byte(cpu, opcode);
-        break;
-
-      case 0b11: /* Rotate */
-        m68k_ro_reg_byte(cpu, opcode);
-        break;
+        return m68k_rox_mem;
+      default: /* Rotate */
+        return m68k_ro_mem;
       }
-      break;
+    }
 
-    case 0b01: /* Register, Word */
-      switch ((opcode >> 3) & 0x3) {
-      case 0b00: /* Arithmetic Shift */
-        m68k_as_reg_word(cpu, opcode);
-        break;
+    switch ((((opcode >> 6) & 0x3) << 2) | ((opcode >> 3) & 0x3)) {
+    case 0b0000: /* Register, Byte, Arithmetic Shift */
+      return m68k_as_reg_byte;
+    case 0b0001: /* Register, Byte, Logical Shift */
+      return m68k_ls_reg_byte;
+    case 0b0010: /* Register, Byte, Rotate with Extend */
+      return m68k_rox_reg_byte;
+    case 0b0011: /* Register, Byte, Rotate */
+      return m68k_ro_reg_byte;
+    case 0b0100: /* Register, Word, Arithmetic Shift */
+      return m68k_as_reg_word;
+    case 0b0101: /* Register, Word, Logical Shift */
+      return m68k_ls_reg_word;
+    case 0b0110: /* Register, Word, Rotate with Extend */
+      return m68k_rox_reg_word;
+    case 0b0111: /* Register, Word, Rotate */
+      return m68k_ro_reg_word;
+    case 0b1000: /* Register, Long, Arithmetic Shift */
+      return m68k_as_reg_long;
+    case 0b1001: /* Register, Long, Logical Shift */
+      return m68k_ls_reg_long;
+    case 0b1010: /* Register, Long, Rotate with Extend */
+      return m68k_rox_reg_long;
+    default: /* Register, Long, Rotate */
+      return m68k_ro_reg_long;
+    }
 
-      case 0b01: /* Logical Shift */
-        m68k_ls_reg_word(cpu, opcode);
-        break;
+  default: /* Coprocessor Interface/MC68040 and CPU32 Extensions */
+    return m68k_line_f;
+  }
+}
 
-      case 0b10: /* Rotate with Extend */
-        m68k_rox_reg_word(cpu, opcode);
-        break;
 
-      case 0b11: /* Rotate */
-        m68k_ro_reg_word(cpu, opcode);
-        break;
-      }
-      break;
 
-    case 0b10: /* Register, Long */
-      switch ((opcode >> 3) & 0x3) {
-      case 0b00: /* Arithmetic Shift */
-        m68k_as_reg_long(cpu, opcode);
-        break;
+static inline bool m68k_block_valid(m68k_block_t *block, mem_t *mem)
+{
+  return mem->code_gen[block->page[0]] == block->gen[0] &&
+         mem->code_gen[block->page[1]] == block->gen[1];
+}
 
-      case 0b01: /* Logical Shift */
-        m68k_ls_reg_long(cpu, opcode);
-        break;
 
-      case 0b10: /* Rotate with Extend */
-        m68k_rox_reg_long(cpu, opcode);
-        break;
 
-      case 0b11: /* Rotate */
-        m68k_ro_reg_long(cpu, opcode);
-        break;
-      }
-      break;
+static void m68k_block_start(m68k_t *cpu, mem_t *mem)
+{
+  m68k_core_t *core = M68K_CORE(cpu);
+  m68k_block_t *block;
 
-    case 0b11: /* Memory */
-      switch ((opcode >> 9) & 0x3) {
-      case 0b00: /* Arithmetic Shift */
-        m68k_as_mem(cpu, mem, opcode);
-        break;
+  core->block_insn = 0;
+  if (cpu->pc % 2 != 0 || cpu->pc > 0xFFFFFF) {
+    return; /* Will cause address error or panic, do not cache. */
+  }
 
-      case 0b01: /* Logical Shift */
-        m68k_ls_mem(cpu, mem, opcode);
-        break;
+  block = &core->block_cache[(cpu->pc >> 1) % M68K_BLOCK_CACHE_SIZE];
+  if (core->block_prev != NULL) {
+    core->block_prev->link[core->block_prev->link_next] = block;
+    core->block_prev->link_next ^= 1;
+    core->block_prev = NULL;
+  }
 
-      case 0b10: /* Rotate with Extend */
-        m68k_rox_mem(cpu, mem, opcode);
-        break;
+  if (block->pc == cpu->pc && m68k_block_valid(block, mem)) {
+    core->block_replay = block;
+    return;
+  }
 
-      case 0b11: /* Rotate */
-        m68k_ro_mem(cpu, mem, opcode);
-        break;
+  /* Mark every page the block can reach, so writes bump the generation. */
+  block->pc = cpu->pc;
+  block->insn_n = 0;
+  block->word_n = 0;
+  block->insn_offset[0] = 0;
+  block->link[0] = NULL;
+  block->link[1] = NULL;
+  block->page[0] = cpu->pc >> MEM_PAGE_SHIFT;
+  block->page[1] = ((cpu->pc + (M68K_BLOCK_WORD_MAX * 2) - 1) & 0xFFFFFF)
+    >> MEM_PAGE_SHIFT;
+  mem_code_mark(mem, cpu->pc);
+  mem_code_mark(mem, cpu->pc + (M68K_BLOCK_WORD_MAX * 2) - 1);
+  block->gen[0] = mem->code_gen[block->page[0]];
+  block->gen[1] = mem->code_gen[block->page[1]];
+  core->block_record = block;
+  core->block_record_broken = false;
+}
+
+
+
+static void m68k_block_stop(m68k_t *cpu, mem_t *mem)
+{
+  m68k_core_t *core = M68K_CORE(cpu);
+  m68k_block_t *block = core->block_record;
+
+  core->block_replay = NULL;
+  core->block_record = NULL;
+  core->block_prev = NULL;
+  if (block == NULL) {
+    return;
+  }
+
+  /* Drop words of a partially decoded instruction. */
+  if (block->insn_n < M68K_BLOCK_INSN_MAX) {
+    block->word_n = block->insn_offset[block->insn_n];
+  }
+  if (block->insn_n == 0 || ! m68k_block_valid(block, mem)) {
+    block->pc = 1; /* Unused */
+  }
+}
+
+
+
+static inline void m68k_block_chain(m68k_t *cpu, mem_t *mem,
+  m68k_block_t *block)
+{
+  m68k_core_t *core = M68K_CORE(cpu);
+  int i;
+
+  for (i = 0; i < 2; i++) {
+    if (block->link[i] != NULL && block->link[i]->pc == cpu->pc &&
+      m68k_block_valid(block->link[i], mem)) {
+      core->block_replay = block->link[i];
+      core->block_insn = 0;
+      return;
+    }
+  }
+  core->block_prev = block; /* Link from m68k_block_start() instead. */
+}
+
+
+
+#ifdef CPU_THREADED
+/* Every handler returned by m68k_decode(), one label each in m68k_run(). */
+#define M68K_HANDLERS(X) \
+  X(m68k_abcd) X(m68k_add) X(m68k_addi) X(m68k_addq) X(m68k_addx) \
+  X(m68k_and) X(m68k_andi) X(m68k_as_mem) X(m68k_as_reg_byte) \
+  X(m68k_as_reg_long) X(m68k_as_reg_word) X(m68k_bchg_imm) X(m68k_bchg_reg) \
+  X(m68k_bclr_imm) X(m68k_bclr_reg) X(m68k_branch) X(m68k_bset_imm) \
+  X(m68k_bset_reg) X(m68k_btst_imm) X(m68k_btst_reg) X(m68k_chk) \
+  X(m68k_clr) X(m68k_cmp_eor) X(m68k_cmpi) X(m68k_cmpm) X(m68k_dbcc) \
+  X(m68k_divs) X(m68k_divu) X(m68k_eori) X(m68k_exg) X(m68k_ext) \
+  X(m68k_illegal) X(m68k_jmp) X(m68k_jsr) X(m68k_lea) X(m68k_line_a) \
+  X(m68k_line_f) X(m68k_link) X(m68k_ls_mem) X(m68k_ls_reg_byte) \
+  X(m68k_ls_reg_long) X(m68k_ls_reg_word) X(m68k_move_from_sr) \
+  X(m68k_move_from_usp) X(m68k_move_to_ccr) X(m68k_move_to_sr) \
+  X(m68k_move_to_usp) X(m68k_moveb) X(m68k_movel) \
+  X(m68k_movem_mem_to_reg_long) X(m68k_movem_mem_to_reg_word) \
+  X(m68k_movem_reg_to_mem_long) X(m68k_movem_reg_to_mem_word) X(m68k_movep) \
+  X(m68k_moveq) X(m68k_movew) X(m68k_muls) X(m68k_mulu) X(m68k_nbcd) \
+  X(m68k_neg) X(m68k_negx) X(m68k_nop) X(m68k_not) X(m68k_or) X(m68k_ori) \
+  X(m68k_pea) X(m68k_reset) X(m68k_ro_mem) X(m68k_ro_reg_byte) \
+  X(m68k_ro_reg_long) X(m68k_ro_reg_word) X(m68k_rox_mem) \
+  X(m68k_rox_reg_byte) X(m68k_rox_reg_long) X(m68k_rox_reg_word) \
+  X(m68k_rte) X(m68k_rtr) X(m68k_rts) X(m68k_sbcd) X(m68k_scc) X(m68k_stop) \
+  X(m68k_sub) X(m68k_subi) X(m68k_subq) X(m68k_subx) X(m68k_swap) \
+  X(m68k_tas) X(m68k_trap) X(m68k_trapv) X(m68k_tst) X(m68k_unlk)
+
+#define M68K_HANDLER_POINTER(name) name,
+static const m68k_handler_t m68k_threaded_handler[] = {
+  M68K_HANDLERS(M68K_HANDLER_POINTER)
+};
+
+#define M68K_HANDLER_N \
+  (sizeof(m68k_threaded_handler) / sizeof(m68k_handler_t))
+
+static void *m68k_threaded_table[0x10000];
+static void * const *m68k_threaded_label; /* Handed out by m68k_run(). */
+static bool m68k_threaded_table_ok;
+static pthread_once_t m68k_threaded_table_once = PTHREAD_ONCE_INIT;
+
+
+
+static inline void *m68k_block_label(m68k_t *cpu, uint16_t opcode)
+{
+  m68k_core_t *core = M68K_CORE(cpu);
+
+  if (core->block_replay != NULL) {
+    return core->block_replay->label[core->block_insn];
+  }
+  if (core->block_record != NULL) {
+    core->block_record->label[core->block_insn] =
+      m68k_threaded_table[opcode];
+  }
+  return m68k_threaded_table[opcode];
+}
+#else
+static inline m68k_handler_t m68k_block_handler(m68k_t *cpu,
+  uint16_t opcode)
+{
+  m68k_core_t *core = M68K_CORE(cpu);
+
+  if (core->block_replay != NULL) {
+    return core->block_replay->handler[core->block_insn];
+  }
+  if (core->block_record != NULL) {
+    core->block_record->handler[core->block_insn] = m68k_opcode_table[opcode];
+  }
+  return m68k_opcode_table[opcode];
+}
+#endif /* CPU_THREADED */
+
+
+
+static inline void m68k_block_next(m68k_t *cpu, mem_t *mem)
+{
+  m68k_core_t *core = M68K_CORE(cpu);
+  m68k_block_t *block;
+
+  core->block_insn++;
+
+  if (core->block_replay != NULL) {
+    block = core->block_replay;
+    if (core->block_insn >= block->insn_n ||
+      cpu->pc != block->pc + (block->insn_offset[core->block_insn] * 2) ||
+      ! m68k_block_valid(block, mem)) {
+      core->block_replay = NULL;
+      if (cpu->chain) {
+        m68k_block_chain(cpu, mem, block);
       }
-      break;
     }
-    break;
 
-  case 0b1111: /* Coprocessor Interface/MC68040 and CPU32 Extensions */
-    m68k_exception(cpu, mem, M68K_VECTOR_UNIMPLEMENTED_F_LINE_OPCODE);
-    break;
+  } else if (core->block_record != NULL) {
+    block = core->block_record;
+    if (core->block_record_broken) {
+      m68k_block_stop(cpu, mem);
+      return;
+    }
+    block->insn_n = core->block_insn;
+    if (core->block_insn < M68K_BLOCK_INSN_MAX) {
+      block->insn_offset[core->block_insn] = block->word_n;
+    }
+    if (core->block_insn >= M68K_BLOCK_INSN_MAX ||
+      block->word_n > M68K_BLOCK_WORD_MAX - M68K_INSN_WORD_MAX ||
+      cpu->pc != block->pc + (block->word_n * 2)) {
+      m68k_block_stop(cpu, mem);
+      if (cpu->chain && block->pc % 2 == 0) { /* Not discarded. */
+        m68k_block_chain(cpu, mem, block);
+      }
+    }
+  }
+}
+
+
+
+static inline void m68k_step_begin(m68k_t *cpu, mem_t *mem)
+{
+  m68k_core_t *core = M68K_CORE(cpu);
+
+  if (core->block_replay == NULL && core->block_record == NULL) {
+    m68k_block_start(cpu, mem);
+  }
+  m68k_trace_start(cpu->trace_state, cpu);
+  cpu->old_pc = cpu->pc;
+}
+
+
+
+static inline void m68k_step_end(m68k_t *cpu)
+{
+  m68k_trace_end(cpu->trace_state);
+#ifdef CPU_BREAKPOINT
+  if (cpu->stop == M68K_RUN_BUDGET &&
+    (int32_t)cpu->pc == cpu->breakpoint_pc) {
+    cpu->stop = M68K_RUN_BREAKPOINT;
+  }
+#else
+  (void)cpu;
+#endif /* CPU_BREAKPOINT */
+}
+
+
+
+m68k_run_t m68k_run(m68k_t *cpu, mem_t *mem, uint32_t budget)
+{
+  m68k_core_t *core;
+  volatile uint32_t executed = 0;
+  uint16_t opcode;
+#ifdef CPU_THREADED
+  m68k_block_t *block;
+#define M68K_HANDLER_LABEL(name) &&name##_label,
+  static void * const label[] = {
+    M68K_HANDLERS(M68K_HANDLER_LABEL)
+  };
+
+  /* Labels only exist in here, hand them out to fill the table. */
+  if (cpu == NULL) {
+    m68k_threaded_label = label;
+    return M68K_RUN_BUDGET;
+  }
+#endif /* CPU_THREADED */
+#if defined(CPU_TRACE_RUNTIME) && ! defined(CPU_TRACE)
+  if (cpu->trace && cpu->trace_state != NULL) {
+    return m68k_run_traced(cpu, mem, budget);
+  }
+#endif
+
+  core = M68K_CORE(cpu);
+  cpu->stop = M68K_RUN_BUDGET;
+
+  if (setjmp(core->exception_jmp) > 0) {
+    m68k_block_stop(cpu, mem);
+    m68k_step_end(cpu);
+    executed++;
+  }
+
+#ifdef CPU_THREADED
+  /* Each handler label ends with its own copy of the dispatch to the next
+     instruction of the block being replayed, so the host branch predictor
+     sees one indirect jump per handler. The block is kept in a local and
+     the opcode is taken straight from its words. Anything else, like
+     leaving the block or recording a new one, goes through the shared
+     slow path. */
+#define M68K_THREADED_NEXT \
+  block = core->block_replay; \
+  if (block != NULL && core->block_insn + 1 < block->insn_n && \
+    cpu->stop == M68K_RUN_BUDGET && executed < budget && \
+    cpu->pc == block->pc + (block->insn_offset[core->block_insn + 1] * 2) && \
+    m68k_block_valid(block, mem)) { \
+    core->block_insn++; \
+    m68k_trace_start(cpu->trace_state, cpu); \
+    cpu->old_pc = cpu->pc; \
+    opcode = block->word[block->insn_offset[core->block_insn]]; \
+    cpu->opcode = opcode; \
+    cpu->pc += 2; \
+    m68k_trace_mc(cpu->trace_state, opcode); \
+    goto *block->label[core->block_insn]; \
+  } \
+  goto threaded_slow;
+
+#define M68K_HANDLER_BODY(name) \
+  name##_label: \
+    name(cpu, mem, opcode); \
+    m68k_step_end(cpu); \
+    executed++; \
+    M68K_THREADED_NEXT
+
+  goto threaded_dispatch;
+
+threaded_slow:
+  m68k_block_next(cpu, mem);
+threaded_dispatch:
+  if (cpu->stop != M68K_RUN_BUDGET || executed >= budget) {
+    goto threaded_done;
+  }
+  m68k_step_begin(cpu, mem);
+  opcode = m68k_fetch(cpu, mem);
+  goto *m68k_block_label(cpu, opcode);
+
+  M68K_HANDLERS(M68K_HANDLER_BODY)
+
+threaded_done:
+#else
+  while (cpu->stop == M68K_RUN_BUDGET && executed < budget) {
+    m68k_step_begin(cpu, mem);
+    opcode = m68k_fetch(cpu, mem);
+    (*m68k_block_handler(cpu, opcode))(cpu, mem, opcode);
+    m68k_step_end(cpu);
+    executed++;
+    m68k_block_next(cpu, mem);
+  }
+#endif /* CPU_THREADED */
+
+  m68k_block_stop(cpu, mem);
+  m68k_cc_flush(cpu); /* Leave real flags behind for outside inspection. */
+  cpu->executed += executed;
+  return cpu->stop;
+}
+
+
+
+static void m68k_opcode_table_init(void)
+{
+  int i;
+
+  for (i = 0; i < 0x10000; i++) {
+    m68k_opcode_table[i] = m68k_decode(i);
   }
+}
+
 
-  m68k_trace_end();
+
+#ifdef CPU_THREADED
+static void m68k_threaded_table_init(void)
+{
+  uint32_t i;
+  uint32_t j;
+
+  m68k_run(NULL, NULL, 0);
+  for (i = 0; i < 0x10000; i++) {
+    for (j = 0; j < M68K_HANDLER_N; j++) {
+      if (m68k_opcode_table[i] == m68k_threaded_handler[j]) {
+        m68k_threaded_table[i] = m68k_threaded_label[j];
+        break;
+      }
+    }
+    if (j == M68K_HANDLER_N) {
+      return; /* Handler missing from M68K_HANDLERS(), m68k_init() fails. */
+    }
+  }
+  m68k_threaded_table_ok = true;
 }
+#endif /* CPU_THREADED */
 
 
 
-void m68k_init(m68k_t *cpu)
+int m68k_init(m68k_t *cpu)
 {
+  int i;
+  m68k_core_t *core;
+
+#if ! (defined(CPU_TRACE_RUNTIME) && defined(CPU_TRACE))
   memset(cpu, 0, sizeof(m68k_t));
   cpu->status.s = 1; /* Always start in supervisor mode. */
+  cpu->breakpoint_pc = -1;
+#endif
+
+  pthread_once(&m68k_opcode_table_once, m68k_opcode_table_init);
+#ifdef CPU_THREADED
+  pthread_once(&m68k_threaded_table_once, m68k_threaded_table_init);
+  if (! m68k_threaded_table_ok) {
+    return -1;
+  }
+#endif /* CPU_THREADED */
+
+  core = calloc(1, sizeof(m68k_core_t));
+  if (core == NULL) {
+    return -1;
+  }
+  for (i = 0; i < M68K_BLOCK_CACHE_SIZE; i++) {
+    core->block_cache[i].pc = 1; /* Unused */
+  }
+  M68K_CORE(cpu) = core;
+
+#if defined(CPU_TRACE_RUNTIME) && ! defined(CPU_TRACE)
+  /* The traced core keeps its own cached blocks. */
+  if (m68k_init_traced(cpu) != 0) {
+    m68k_free(cpu);
+    return -1;
+  }
+#endif
+  return 0;
+}
+
+
+
+void m68k_free(m68k_t *cpu)
+{
+  free(M68K_CORE(cpu));
+  M68K_CORE(cpu) = NULL;
+#if defined(CPU_TRACE_RUNTIME) && ! defined(CPU_TRACE)
+  m68k_free_traced(cpu);
+#endif
 }
 
 
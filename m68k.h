@@ -5,7 +5,22 @@
 #include <stdint.h>
 #include "mem.h"
 
-typedef void (*m68k_trap_hook_t)(uint32_t d[8]);
+typedef bool (*m68k_trap_hook_t)(void *context, uint32_t d[8]);
+
+typedef enum {
+  M68K_RUN_BUDGET,     /* Instruction Budget Used Up */
+  M68K_RUN_BREAKPOINT, /* Breakpoint Reached */
+  M68K_RUN_TRAP,       /* Requested by Trap Hook */
+  M68K_RUN_STOP,       /* STOP Instruction */
+  M68K_RUN_PANIC,      /* Panic */
+} m68k_run_t;
+
+typedef enum {
+  M68K_CC_NONE,  /* Flags Up To Date */
+  M68K_CC_ADD,   /* Pending from Addition */
+  M68K_CC_SUB,   /* Pending from Subtraction or Compare */
+  M68K_CC_LOGIC, /* Pending from Logic or Move */
+} m68k_cc_op_t;
 
 typedef enum {
   M68K_LOCATION_NONE, /* Not Set */
@@ -49,12 +64,28 @@ typedef struct m68k_s {
     uint16_t sr; /* Status Register */
   };
 
+  /* N, Z, V and C are only valid in the status register after
+     m68k_cc_flush(), X is always kept up to date. */
+  m68k_cc_op_t cc_op; /* Pending Condition Code Operation */
+  uint32_t cc_src;    /* Source Operand */
+  uint32_t cc_dst;    /* Destination Operand */
+  uint32_t cc_res;    /* Result */
+  uint32_t cc_msb;    /* Sign Bit Mask for Operation Size */
+
   uint32_t old_pc; /* Old Program Counter */
   uint16_t opcode; /* Current Opcode */
   m68k_ea_t src;   /* Current Source */
   m68k_ea_t dst;   /* Current Destination */
 
-  m68k_trap_hook_t trap_15_hook;
+  m68k_trap_hook_t trap_15_hook; /* Return true to leave m68k_run(). */
+  void *context; /* Passed to the trap hook and panic(). */
+  struct m68k_core_s *core[2]; /* Cached blocks of plain and traced core. */
+  struct m68k_trace_s *trace_state; /* Where the traced core records to. */
+  uint64_t executed; /* Instructions executed by m68k_run() in total. */
+  int32_t breakpoint_pc; /* Negative if not set. */
+  m68k_run_t stop; /* Set to leave m68k_run() after current instruction. */
+  bool chain; /* Link cached blocks directly to their successors. */
+  bool trace; /* Record trace, needs a CPU_TRACE_RUNTIME build. */
 } m68k_t;
 
 #define M68K_SP 7 /* User Stack Pointer = A7 */
@@ -68,7 +99,15 @@ typedef struct m68k_s {
 #define M68K_VECTOR_UNIMPLEMENTED_A_LINE_OPCODE 0x00000028
 #define M68K_VECTOR_UNIMPLEMENTED_F_LINE_OPCODE 0x0000002C
 
-void m68k_execute(m68k_t *cpu, mem_t *mem);
-void m68k_init(m68k_t *cpu);
+m68k_run_t m68k_run(m68k_t *cpu, mem_t *mem, uint32_t budget);
+void m68k_cc_flush(m68k_t *cpu);
+int m68k_init(m68k_t *cpu);
+void m68k_free(m68k_t *cpu);
+
+#ifdef CPU_TRACE_RUNTIME
+m68k_run_t m68k_run_traced(m68k_t *cpu, mem_t *mem, uint32_t budget);
+int m68k_init_traced(m68k_t *cpu);
+void m68k_free_traced(m68k_t *cpu);
+#endif /* CPU_TRACE_RUNTIME */
 
 #endif /* _M68K_H */
@@ -0,0 +1,758 @@
+#include "m68k_disasm.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+
+#define EA_MODE_DR_DIRECT        0b000 /* Dn */
+#define EA_MODE_AR_DIRECT        0b001 /* An */
+#define EA_MODE_AR_INDIRECT      0b010 /* (An) */
+#define EA_MODE_AR_POST_INC      0b011 /* (An)+ */
+#define EA_MODE_AR_PRE_DEC       0b100 /* -(An) */
+#define EA_MODE_AR_DISP_16       0b101 /* (d16,An) */
+#define EA_MODE_AR_DISP_8        0b110 /* (d8,An,Xn) */
+#define EA_MODE_EXT              0b111
+#define EA_MODE_EXT_ABS_WORD     0b000 /* (xxx).W */
+#define EA_MODE_EXT_ABS_LONG     0b001 /* (xxx).L */
+#define EA_MODE_EXT_PC_DISP_16   0b010 /* (d16,PC) */
+#define EA_MODE_EXT_PC_DISP_8    0b011 /* (d8,PC,Xn) */
+#define EA_MODE_EXT_IMMEDIATE    0b100 /* #<data> */
+
+/* Machine code words of one instruction, consumed in fetch order. */
+typedef struct m68k_disasm_mc_s {
+  const uint16_t *word;
+  int word_n;
+  int index;
+} m68k_disasm_mc_t;
+
+static const char *m68k_disasm_cc[16] = {
+  "T", "F", "HI", "LS", "CC", "CS", "NE", "EQ",
+  "VC", "VS", "PL", "MI", "GE", "LT", "GT", "LE",
+};
+
+static const char m68k_disasm_size[3] = {'B', 'W', 'L'};
+static const int m68k_disasm_width[3] = {1, 2, 4};
+
+
+
+static uint16_t m68k_disasm_fetch(m68k_disasm_mc_t *mc)
+{
+  if (mc->index >= mc->word_n) {
+    mc->index++;
+    return 0; /* Instruction was cut short, e.g. by an address error. */
+  }
+  return mc->word[mc->index++];
+}
+
+
+
+static void m68k_disasm_ea(m68k_disasm_mc_t *mc, char *s,
+  uint8_t reg, uint8_t mode, int width)
+{
+  uint32_t value;
+
+  switch (mode) {
+  case EA_MODE_DR_DIRECT:
+    snprintf(s, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+    break;
+
+  case EA_MODE_AR_DIRECT:
+    snprintf(s, M68K_DISASM_OPERAND_MAX, "A%d", reg);
+    break;
+
+  case EA_MODE_AR_INDIRECT:
+    snprintf(s, M68K_DISASM_OPERAND_MAX, "(A%d)", reg);
+    break;
+
+  case EA_MODE_AR_POST_INC:
+    snprintf(s, M68K_DISASM_OPERAND_MAX, "(A%d)+", reg);
+    break;
+
+  case EA_MODE_AR_PRE_DEC:
+    snprintf(s, M68K_DISASM_OPERAND_MAX, "-(A%d)", reg);
+    break;
+
+  case EA_MODE_AR_DISP_16:
+    m68k_disasm_fetch(mc);
+    snprintf(s, M68K_DISASM_OPERAND_MAX, "(d16, A%d)", reg);
+    break;
+
+  case EA_MODE_AR_DISP_8:
+    m68k_disasm_fetch(mc);
+    snprintf(s, M68K_DISASM_OPERAND_MAX, "(d8, A%d, Xn)", reg);
+    break;
+
+  case EA_MODE_EXT:
+    switch (reg) {
+    case EA_MODE_EXT_ABS_WORD:
+      value = (int16_t)m68k_disasm_fetch(mc);
+      snprintf(s, M68K_DISASM_OPERAND_MAX, "($%08x).W", value);
+      break;
+
+    case EA_MODE_EXT_ABS_LONG:
+      value = m68k_disasm_fetch(mc) << 16;
+      value |= m68k_disasm_fetch(mc);
+      snprintf(s, M68K_DISASM_OPERAND_MAX, "($%08x).L", value);
+      break;
+
+    case EA_MODE_EXT_PC_DISP_16:
+      m68k_disasm_fetch(mc);
+      snprintf(s, M68K_DISASM_OPERAND_MAX, "(d16, PC)");
+      break;
+
+    case EA_MODE_EXT_PC_DISP_8:
+      m68k_disasm_fetch(mc);
+      snprintf(s, M68K_DISASM_OPERAND_MAX, "(d8, PC, Xn)");
+      break;
+
+    case EA_MODE_EXT_IMMEDIATE:
+      if (width == 4) {
+        value = m68k_disasm_fetch(mc) << 16;
+        value |= m68k_disasm_fetch(mc);
+        snprintf(s, M68K_DISASM_OPERAND_MAX, "#$%08x", value);
+      } else if (width == 2) {
+        value = m68k_disasm_fetch(mc);
+        snprintf(s, M68K_DISASM_OPERAND_MAX, "#$%04x", value);
+      } else {
+        value = m68k_disasm_fetch(mc) & 0xFF;
+        snprintf(s, M68K_DISASM_OPERAND_MAX, "#$%02x", value);
+      }
+      break;
+
+    default:
+      s[0] = '\0'; /* Illegal, raises an exception. */
+      break;
+    }
+    break;
+  }
+}
+
+
+
+static void m68k_disasm_mnemonic(m68k_disasm_t *disasm,
+  const char *name, int size)
+{
+  if (size < 0) {
+    snprintf(disasm->mnemonic, M68K_DISASM_MNEMONIC_MAX, "%s", name);
+  } else {
+    /* Room for the size suffix and terminator. */
+    snprintf(disasm->mnemonic, M68K_DISASM_MNEMONIC_MAX, "%.*s.%c",
+      M68K_DISASM_MNEMONIC_MAX - 3, name, m68k_disasm_size[size]);
+  }
+}
+
+
+
+/* <ea>,Dn / <ea>,An / Dn,<ea> forms of OR, SUB, CMP, EOR, AND and ADD. */
+static void m68k_disasm_reg_ea(m68k_disasm_t *disasm, m68k_disasm_mc_t *mc,
+  uint16_t opcode, const char *name, const char *name_a, const char *name_ea)
+{
+  uint8_t ea_reg  =  opcode       & 0b111;
+  uint8_t ea_mode = (opcode >> 3) & 0b111;
+  uint8_t op_mode = (opcode >> 6) & 0b111;
+  uint8_t reg     = (opcode >> 9) & 0b111;
+
+  switch (op_mode) {
+  case 0b000:
+  case 0b001:
+  case 0b010:
+    m68k_disasm_mnemonic(disasm, name, op_mode);
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode,
+      m68k_disasm_width[op_mode]);
+    break;
+
+  case 0b011:
+  case 0b111:
+    if (name_a == NULL) {
+      break;
+    }
+    m68k_disasm_mnemonic(disasm, name_a, op_mode == 0b011 ? 1 : 2);
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "A%d", reg);
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode,
+      op_mode == 0b011 ? 2 : 4);
+    break;
+
+  default:
+    m68k_disasm_mnemonic(disasm, name_ea, op_mode - 0b100);
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode,
+      m68k_disasm_width[op_mode - 0b100]);
+    break;
+  }
+}
+
+
+
+/* ABCD, SBCD, ADDX and SUBX. */
+static void m68k_disasm_x(m68k_disasm_t *disasm, uint16_t opcode)
+{
+  uint8_t reg_y =  opcode       & 0b111;
+  uint8_t rm    = (opcode >> 3) & 0b1;
+  uint8_t reg_x = (opcode >> 9) & 0b111;
+
+  if (rm) {
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "-(A%d)", reg_y);
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "-(A%d)", reg_x);
+  } else {
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "D%d", reg_y);
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", reg_x);
+  }
+}
+
+
+
+static void m68k_disasm_immediate(m68k_disasm_t *disasm,
+  m68k_disasm_mc_t *mc, uint16_t opcode, const char *name, bool ccr_sr)
+{
+  uint32_t value;
+  uint8_t ea_reg  =  opcode       & 0b111;
+  uint8_t ea_mode = (opcode >> 3) & 0b111;
+  uint8_t size    = (opcode >> 6) & 0b11;
+
+  if (size == 0b11) {
+    return;
+  }
+
+  m68k_disasm_mnemonic(disasm, name, size);
+  switch (size) {
+  case 0b00:
+    value = m68k_disasm_fetch(mc) & 0xFF;
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "#$%02x", value);
+    break;
+
+  case 0b01:
+    value = m68k_disasm_fetch(mc);
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "#$%04x", value);
+    break;
+
+  default:
+    value = m68k_disasm_fetch(mc) << 16;
+    value |= m68k_disasm_fetch(mc);
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "#$%08x", value);
+    break;
+  }
+
+  if (ccr_sr && size != 0b10 &&
+    ea_mode == EA_MODE_EXT && ea_reg == EA_MODE_EXT_IMMEDIATE) {
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "%s",
+      size == 0b00 ? "CCR" : "SR");
+  } else {
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, m68k_disasm_width[size]);
+  }
+}
+
+
+
+static void m68k_disasm_bit(m68k_disasm_t *disasm,
+  m68k_disasm_mc_t *mc, uint16_t opcode)
+{
+  static const char *name[4] = {"BTST", "BCHG", "BCLR", "BSET"};
+  uint8_t ea_reg  =  opcode       & 0b111;
+  uint8_t ea_mode = (opcode >> 3) & 0b111;
+  uint8_t reg     = (opcode >> 9) & 0b111;
+
+  m68k_disasm_mnemonic(disasm, name[(opcode >> 6) & 0b11], -1);
+  if ((opcode >> 8) & 1) {
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+  } else {
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "#%d",
+      m68k_disasm_fetch(mc));
+  }
+  m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, 1);
+}
+
+
+
+static void m68k_disasm_misc(m68k_disasm_t *disasm,
+  m68k_disasm_mc_t *mc, uint16_t opcode)
+{
+  uint8_t ea_reg  =  opcode       & 0b111;
+  uint8_t ea_mode = (opcode >> 3) & 0b111;
+  uint8_t size    = (opcode >> 6) & 0b11;
+  uint8_t reg     = (opcode >> 9) & 0b111;
+
+  switch ((opcode >> 6) & 0x3F) {
+  case 0b000000:
+  case 0b000001:
+  case 0b000010:
+    m68k_disasm_mnemonic(disasm, "NEGX", size);
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, m68k_disasm_width[size]);
+    break;
+
+  case 0b001000:
+  case 0b001001:
+  case 0b001010:
+    m68k_disasm_mnemonic(disasm, "CLR", size);
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, m68k_disasm_width[size]);
+    break;
+
+  case 0b010000:
+  case 0b010001:
+  case 0b010010:
+    m68k_disasm_mnemonic(disasm, "NEG", size);
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, m68k_disasm_width[size]);
+    break;
+
+  case 0b011000:
+  case 0b011001:
+  case 0b011010:
+    m68k_disasm_mnemonic(disasm, "NOT", size);
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, m68k_disasm_width[size]);
+    break;
+
+  case 0b101000:
+  case 0b101001:
+  case 0b101010:
+    m68k_disasm_mnemonic(disasm, "TST", size);
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, m68k_disasm_width[size]);
+    break;
+
+  case 0b000110:
+  case 0b001110:
+  case 0b010110:
+  case 0b011110:
+  case 0b100110:
+  case 0b101110:
+  case 0b110110:
+  case 0b111110:
+    m68k_disasm_mnemonic(disasm, "CHK", -1);
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, 2);
+    break;
+
+  case 0b000111:
+  case 0b001111:
+  case 0b010111:
+  case 0b011111:
+  case 0b100111:
+  case 0b101111:
+  case 0b110111:
+  case 0b111111:
+    m68k_disasm_mnemonic(disasm, "LEA", -1);
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "A%d", reg);
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, 4);
+    break;
+
+  case 0b010011:
+    m68k_disasm_mnemonic(disasm, "MOVE", 1);
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "CCR");
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, 2);
+    break;
+
+  case 0b011011:
+    m68k_disasm_mnemonic(disasm, "MOVE", 1);
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "SR");
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, 2);
+    break;
+
+  case 0b000011:
+    m68k_disasm_mnemonic(disasm, "MOVE", 1);
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "SR");
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, 2);
+    break;
+
+  case 0b100000:
+    m68k_disasm_mnemonic(disasm, "NBCD", -1);
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, 1);
+    break;
+
+  case 0b100001:
+    if (ea_mode == EA_MODE_DR_DIRECT) {
+      m68k_disasm_mnemonic(disasm, "SWAP", -1);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", ea_reg);
+    } else if (ea_mode == EA_MODE_AR_INDIRECT ||
+      ea_mode == EA_MODE_AR_DISP_16 ||
+      ea_mode == EA_MODE_AR_DISP_8 ||
+      ea_mode == EA_MODE_EXT) {
+      m68k_disasm_mnemonic(disasm, "PEA", -1);
+      m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, 4);
+    }
+    break;
+
+  case 0b101011:
+    m68k_disasm_mnemonic(disasm, "TAS", -1);
+    m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, 1);
+    break;
+
+  case 0b100010:
+  case 0b100011:
+    if (ea_mode == EA_MODE_DR_DIRECT) {
+      m68k_disasm_mnemonic(disasm, "EXT", size == 0b10 ? 1 : 2);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", ea_reg);
+    } else {
+      m68k_disasm_mnemonic(disasm, "MOVEM", size == 0b10 ? 1 : 2);
+      m68k_disasm_fetch(mc); /* Register list mask. */
+      snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "*");
+      m68k_disasm_ea(mc, disasm->dst, ea_reg, ea_mode, size == 0b10 ? 2 : 4);
+    }
+    break;
+
+  case 0b110010:
+  case 0b110011:
+    m68k_disasm_mnemonic(disasm, "MOVEM", size == 0b10 ? 1 : 2);
+    m68k_disasm_fetch(mc); /* Register list mask. */
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "*");
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, size == 0b10 ? 2 : 4);
+    break;
+
+  case 0b111011:
+    m68k_disasm_mnemonic(disasm, "JMP", -1);
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, 4);
+    break;
+
+  case 0b111010:
+    m68k_disasm_mnemonic(disasm, "JSR", -1);
+    m68k_disasm_ea(mc, disasm->src, ea_reg, ea_mode, 4);
+    break;
+
+  case 0b111001:
+    switch (ea_mode) {
+    case 0b000:
+    case 0b001:
+      m68k_disasm_mnemonic(disasm, "TRAP", -1);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "%d", opcode & 0b1111);
+      break;
+
+    case 0b010:
+      m68k_disasm_mnemonic(disasm, "LINK", -1);
+      snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "A%d", ea_reg);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "#%+hd",
+        (int16_t)m68k_disasm_fetch(mc));
+      break;
+
+    case 0b011:
+      m68k_disasm_mnemonic(disasm, "UNLK", -1);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "A%d", ea_reg);
+      break;
+
+    case 0b100:
+      m68k_disasm_mnemonic(disasm, "MOVE", 2);
+      snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "A%d", ea_reg);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "USP");
+      break;
+
+    case 0b101:
+      m68k_disasm_mnemonic(disasm, "MOVE", 2);
+      snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "USP");
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "A%d", ea_reg);
+      break;
+
+    case 0b110:
+      switch (ea_reg) {
+      case 0b000:
+        m68k_disasm_mnemonic(disasm, "RESET", -1);
+        break;
+      case 0b001:
+        m68k_disasm_mnemonic(disasm, "NOP", -1);
+        break;
+      case 0b010:
+        m68k_disasm_mnemonic(disasm, "STOP", -1);
+        m68k_disasm_fetch(mc); /* New SR. */
+        break;
+      case 0b011:
+        m68k_disasm_mnemonic(disasm, "RTE", -1);
+        break;
+      case 0b101:
+        m68k_disasm_mnemonic(disasm, "RTS", -1);
+        break;
+      case 0b110:
+        m68k_disasm_mnemonic(disasm, "TRAPV", -1);
+        break;
+      case 0b111:
+        m68k_disasm_mnemonic(disasm, "RTR", -1);
+        break;
+      default:
+        break;
+      }
+      break;
+
+    default:
+      break;
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+
+
+static void m68k_disasm_shift(m68k_disasm_t *disasm,
+  m68k_disasm_mc_t *mc, uint16_t opcode)
+{
+  static const char *name[4] = {"AS", "LS", "ROX", "RO"};
+  char s[M68K_DISASM_MNEMONIC_MAX];
+  uint8_t reg   =  opcode       & 0b111;
+  uint8_t ir    = (opcode >> 5) & 0b1;
+  uint8_t size  = (opcode >> 6) & 0b11;
+  uint8_t dr    = (opcode >> 8) & 0b1;
+  uint8_t count = (opcode >> 9) & 0b111;
+
+  if (size == 0b11) { /* Memory */
+    snprintf(s, sizeof(s), "%s%c", name[(opcode >> 9) & 0b11],
+      dr ? 'L' : 'R');
+    m68k_disasm_mnemonic(disasm, s, 1);
+    m68k_disasm_ea(mc, disasm->dst, reg, (opcode >> 3) & 0b111, 2);
+    return;
+  }
+
+  snprintf(s, sizeof(s), "%s%c", name[(opcode >> 3) & 0b11],
+    dr ? 'L' : 'R');
+  m68k_disasm_mnemonic(disasm, s, size);
+  snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+  if (ir) {
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "D%d", count);
+  } else {
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "#%d", count);
+  }
+}
+
+
+
+/* Decode one instruction from its machine code words, as recorded by the
+   trace, without touching CPU or memory state. Unknown or illegal opcodes
+   leave the mnemonic empty. Returns the number of words decoded. */
+int m68k_disasm(m68k_disasm_t *disasm, uint32_t pc,
+  const uint16_t *word, int word_n)
+{
+  m68k_disasm_mc_t mc;
+  uint16_t opcode;
+  uint32_t address;
+  int16_t disp;
+  uint8_t ea_reg;
+  uint8_t ea_mode;
+  uint8_t op_mode;
+  uint8_t size;
+  uint8_t reg;
+  char s[M68K_DISASM_MNEMONIC_MAX];
+
+  disasm->mnemonic[0] = '\0';
+  disasm->src[0] = '\0';
+  disasm->dst[0] = '\0';
+
+  mc.word = word;
+  mc.word_n = word_n;
+  mc.index = 0;
+
+  opcode  = m68k_disasm_fetch(&mc);
+  ea_reg  =  opcode       & 0b111;
+  ea_mode = (opcode >> 3) & 0b111;
+  op_mode = (opcode >> 6) & 0b111;
+  size    = (opcode >> 6) & 0b11;
+  reg     = (opcode >> 9) & 0b111;
+
+  switch (opcode >> 12) {
+  case 0b0000: /* Bit Manipulation/MOVEP/Immediate */
+    if (ea_mode == EA_MODE_AR_DIRECT) {
+      if (op_mode < 0b100) {
+        break;
+      }
+      m68k_disasm_mnemonic(disasm, "MOVEP", (op_mode & 1) ? 2 : 1);
+      m68k_disasm_fetch(&mc);
+      if (op_mode < 0b110) {
+        snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "(d16, A%d)", ea_reg);
+        snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+      } else {
+        snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+        snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "(d16, A%d)", ea_reg);
+      }
+      break;
+    }
+
+    switch ((opcode >> 8) & 0xF) {
+    case 0b0000:
+      m68k_disasm_immediate(disasm, &mc, opcode, "ORI", true);
+      break;
+    case 0b0010:
+      m68k_disasm_immediate(disasm, &mc, opcode, "ANDI", true);
+      break;
+    case 0b0100:
+      m68k_disasm_immediate(disasm, &mc, opcode, "SUBI", false);
+      break;
+    case 0b0110:
+      m68k_disasm_immediate(disasm, &mc, opcode, "ADDI", false);
+      break;
+    case 0b1010:
+      m68k_disasm_immediate(disasm, &mc, opcode, "EORI", true);
+      break;
+    case 0b1100:
+      m68k_disasm_immediate(disasm, &mc, opcode, "CMPI", false);
+      break;
+    case 0b1000:
+      m68k_disasm_bit(disasm, &mc, opcode);
+      break;
+    default:
+      if ((opcode >> 8) & 1) {
+        m68k_disasm_bit(disasm, &mc, opcode);
+      }
+      break;
+    }
+    break;
+
+  case 0b0001: /* Move Byte */
+  case 0b0010: /* Move Long */
+  case 0b0011: /* Move Word */
+    size = ((opcode >> 12) == 0b0001) ? 0 : ((opcode >> 12) == 0b0011) ? 1 : 2;
+    m68k_disasm_mnemonic(disasm,
+      (op_mode == EA_MODE_AR_DIRECT && size != 0) ? "MOVEA" : "MOVE", size);
+    m68k_disasm_ea(&mc, disasm->src, ea_reg, ea_mode,
+      m68k_disasm_width[size]);
+    m68k_disasm_ea(&mc, disasm->dst, reg, op_mode,
+      m68k_disasm_width[size]);
+    break;
+
+  case 0b0100: /* Miscellaneous */
+    m68k_disasm_misc(disasm, &mc, opcode);
+    break;
+
+  case 0b0101: /* ADDQ/SUBQ/Scc/DBcc */
+    if (size == 0b11) {
+      if (ea_mode == EA_MODE_AR_DIRECT) {
+        snprintf(s, sizeof(s), "D%s", m68k_disasm_cc[(opcode >> 8) & 0xF]);
+        m68k_disasm_mnemonic(disasm, s, -1);
+        disp = (int16_t)m68k_disasm_fetch(&mc);
+        snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "D%d", ea_reg);
+        snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "$%08x",
+          pc + 2 + disp);
+      } else {
+        snprintf(s, sizeof(s), "S%s", m68k_disasm_cc[(opcode >> 8) & 0xF]);
+        m68k_disasm_mnemonic(disasm, s, -1);
+        m68k_disasm_ea(&mc, disasm->dst, ea_reg, ea_mode, 1);
+      }
+    } else {
+      m68k_disasm_mnemonic(disasm, ((opcode >> 8) & 1) ? "SUBQ" : "ADDQ",
+        size);
+      snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "%d",
+        reg == 0 ? 8 : reg);
+      m68k_disasm_ea(&mc, disasm->dst, ea_reg, ea_mode,
+        m68k_disasm_width[size]);
+    }
+    break;
+
+  case 0b0110: /* Bcc/BSR/BRA */
+    switch ((opcode >> 8) & 0xF) {
+    case 0b0000:
+      m68k_disasm_mnemonic(disasm, "BRA", -1);
+      break;
+    case 0b0001:
+      m68k_disasm_mnemonic(disasm, "BSR", -1);
+      break;
+    default:
+      snprintf(s, sizeof(s), "B%s", m68k_disasm_cc[(opcode >> 8) & 0xF]);
+      m68k_disasm_mnemonic(disasm, s, -1);
+      break;
+    }
+    disp = (int8_t)(opcode & 0xFF);
+    if (disp == 0) {
+      disp = (int16_t)m68k_disasm_fetch(&mc);
+    }
+    address = pc + 2 + disp;
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "$%08x", address);
+    break;
+
+  case 0b0111: /* MOVEQ */
+    m68k_disasm_mnemonic(disasm, "MOVEQ", -1);
+    snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "%d",
+      (int8_t)(opcode & 0xFF));
+    snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+    break;
+
+  case 0b1000: /* OR/DIV/SBCD */
+    if (op_mode == 0b011 || op_mode == 0b111) {
+      m68k_disasm_mnemonic(disasm, op_mode == 0b011 ? "DIVU" : "DIVS", -1);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+      m68k_disasm_ea(&mc, disasm->src, ea_reg, ea_mode, 2);
+    } else if (op_mode == 0b100 &&
+      (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT)) {
+      m68k_disasm_mnemonic(disasm, "SBCD", -1);
+      m68k_disasm_x(disasm, opcode);
+    } else if (op_mode > 0b100 && ea_mode == EA_MODE_AR_DIRECT) {
+      break;
+    } else {
+      m68k_disasm_reg_ea(disasm, &mc, opcode, "OR", NULL, "OR");
+    }
+    break;
+
+  case 0b1001: /* SUB/SUBX */
+    if (op_mode >= 0b100 && op_mode <= 0b110 &&
+      (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT)) {
+      m68k_disasm_mnemonic(disasm, "SUBX", size);
+      m68k_disasm_x(disasm, opcode);
+    } else {
+      m68k_disasm_reg_ea(disasm, &mc, opcode, "SUB", "SUBA", "SUB");
+    }
+    break;
+
+  case 0b1011: /* CMP/EOR */
+    if (op_mode >= 0b100 && op_mode <= 0b110 &&
+      ea_mode == EA_MODE_AR_DIRECT) {
+      m68k_disasm_mnemonic(disasm, "CMPM", size);
+      snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "(A%d)+", ea_reg);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "(A%d)+", reg);
+    } else {
+      m68k_disasm_reg_ea(disasm, &mc, opcode, "CMP", "CMPA", "EOR");
+    }
+    break;
+
+  case 0b1100: /* AND/MUL/ABCD/EXG */
+    if (op_mode == 0b011 || op_mode == 0b111) {
+      m68k_disasm_mnemonic(disasm, op_mode == 0b011 ? "MULU" : "MULS", -1);
+      snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+      m68k_disasm_ea(&mc, disasm->src, ea_reg, ea_mode, 2);
+    } else if (op_mode == 0b100 &&
+      (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT)) {
+      m68k_disasm_mnemonic(disasm, "ABCD", -1);
+      m68k_disasm_x(disasm, opcode);
+    } else if ((op_mode == 0b101 &&
+      (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT)) ||
+      (op_mode == 0b110 && ea_mode == EA_MODE_AR_DIRECT)) {
+      switch ((opcode >> 3) & 0b11111) {
+      case 0b01000:
+        snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+        snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "D%d", ea_reg);
+        break;
+      case 0b01001:
+        snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "A%d", reg);
+        snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "A%d", ea_reg);
+        break;
+      case 0b10001:
+        snprintf(disasm->src, M68K_DISASM_OPERAND_MAX, "D%d", reg);
+        snprintf(disasm->dst, M68K_DISASM_OPERAND_MAX, "A%d", ea_reg);
+        break;
+      default:
+        break;
+      }
+      m68k_disasm_mnemonic(disasm, "EXG", -1);
+    } else if (op_mode == 0b110 && ea_mode == EA_MODE_DR_DIRECT) {
+      break;
+    } else {
+      m68k_disasm_reg_ea(disasm, &mc, opcode, "AND", NULL, "AND");
+    }
+    break;
+
+  case 0b1101: /* ADD/ADDX */
+    if (op_mode >= 0b100 && op_mode <= 0b110 &&
+      (ea_mode == EA_MODE_DR_DIRECT || ea_mode == EA_MODE_AR_DIRECT)) {
+      m68k_disasm_mnemonic(disasm, "ADDX", size);
+      m68k_disasm_x(disasm, opcode);
+    } else {
+      m68k_disasm_reg_ea(disasm, &mc, opcode, "ADD", "ADDA", "ADD");
+    }
+    break;
+
+  case 0b1110: /* Shift/Rotate */
+    m68k_disasm_shift(disasm, &mc, opcode);
+    break;
+
+  default: /* Line A, Line F */
+    break;
+  }
+
+  return mc.index;
+}
+
+
+
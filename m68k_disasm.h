@@ -0,0 +1,18 @@
+#ifndef _M68K_DISASM_H
+#define _M68K_DISASM_H
+
+#include <stdint.h>
+
+#define M68K_DISASM_MNEMONIC_MAX 16
+#define M68K_DISASM_OPERAND_MAX 16
+
+typedef struct m68k_disasm_s {
+  char mnemonic[M68K_DISASM_MNEMONIC_MAX];
+  char src[M68K_DISASM_OPERAND_MAX];
+  char dst[M68K_DISASM_OPERAND_MAX];
+} m68k_disasm_t;
+
+int m68k_disasm(m68k_disasm_t *disasm, uint32_t pc,
+  const uint16_t *word, int word_n);
+
+#endif /* _M68K_DISASM_H */
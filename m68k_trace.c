@@ -1,111 +1,278 @@
 #include "m68k_trace.h"
-#include <stdarg.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "m68k.h"
+#include "m68k_disasm.h"
 
 
 
-#define M68K_TRACE_BUFFER_SIZE 64
 #define M68K_TRACE_MC_MAX 8
-#define M68K_TRACE_OP_MNEMONIC_MAX 16
-#define M68K_TRACE_OP_SRC_MAX 16
-#define M68K_TRACE_OP_DST_MAX 16
 
-typedef struct m68k_trace_s {
+/* Records per half of the double-buffered trace file writer. */
+#define M68K_TRACE_FILE_BUFFER_SIZE 65536
+
+/* Only raw facts are recorded, disassembly is deferred until dump. */
+typedef struct m68k_trace_entry_s {
   m68k_t cpu;
   uint16_t mc[M68K_TRACE_MC_MAX];
   int mc_n;
-  char op_mnemonic[M68K_TRACE_OP_MNEMONIC_MAX];
-  char op_src[M68K_TRACE_OP_SRC_MAX];
-  char op_dst[M68K_TRACE_OP_DST_MAX];
-} m68k_trace_t;
+} m68k_trace_entry_t;
+
+struct m68k_trace_s {
+  m68k_trace_entry_t *buffer;
+  int buffer_size;
+  int buffer_n;
+
+  FILE *file;
+  m68k_trace_record_t *file_buffer[2];
+  int file_buffer_n; /* Records in the active buffer. */
+  int file_active;
+  int file_pending; /* Buffer handed to the writer, -1 if none. */
+  int file_pending_n;
+  bool file_quit;
+  pthread_t file_thread;
+  pthread_mutex_t file_mutex;
+  pthread_cond_t file_cond;
+};
+
+
+
+static void *m68k_trace_file_writer(void *arg)
+{
+  m68k_trace_t *trace = arg;
+  int pending;
+  int n;
+
+  pthread_mutex_lock(&trace->file_mutex);
+  while (1) {
+    while (trace->file_pending == -1 && ! trace->file_quit) {
+      pthread_cond_wait(&trace->file_cond, &trace->file_mutex);
+    }
+    if (trace->file_pending == -1) {
+      break; /* Quit with nothing left to write. */
+    }
+    pending = trace->file_pending;
+    n = trace->file_pending_n;
+    pthread_mutex_unlock(&trace->file_mutex);
 
+    fwrite(trace->file_buffer[pending], sizeof(m68k_trace_record_t), n,
+      trace->file);
 
+    pthread_mutex_lock(&trace->file_mutex);
+    trace->file_pending = -1;
+    pthread_cond_broadcast(&trace->file_cond);
+  }
+  pthread_mutex_unlock(&trace->file_mutex);
 
-static m68k_trace_t trace_buffer[M68K_TRACE_BUFFER_SIZE];
-static int trace_buffer_n = 0;
+  return NULL;
+}
 
 
 
-void m68k_trace_start(m68k_t *cpu)
+/* Hand the active buffer to the writer thread and continue in the other,
+   only blocking if the writer has not finished the previous one yet. */
+static void m68k_trace_file_swap(m68k_trace_t *trace)
 {
-  memcpy(&trace_buffer[trace_buffer_n].cpu, cpu, sizeof(m68k_t));
-  trace_buffer[trace_buffer_n].mc_n = 0; /* Clear before use! */
-  trace_buffer[trace_buffer_n].op_mnemonic[0] = '\0';
-  trace_buffer[trace_buffer_n].op_src[0] = '\0';
-  trace_buffer[trace_buffer_n].op_dst[0] = '\0';
+  pthread_mutex_lock(&trace->file_mutex);
+  while (trace->file_pending != -1) {
+    pthread_cond_wait(&trace->file_cond, &trace->file_mutex);
+  }
+  trace->file_pending = trace->file_active;
+  trace->file_pending_n = trace->file_buffer_n;
+  pthread_cond_broadcast(&trace->file_cond);
+  pthread_mutex_unlock(&trace->file_mutex);
+
+  trace->file_active ^= 1;
+  trace->file_buffer_n = 0;
 }
 
 
 
-void m68k_trace_mc(uint16_t mc)
+static inline void m68k_trace_file_record(m68k_trace_t *trace,
+  m68k_trace_entry_t *entry)
 {
-  trace_buffer[trace_buffer_n].mc[trace_buffer[trace_buffer_n].mc_n] = mc;
-  trace_buffer[trace_buffer_n].mc_n++;
-  if (trace_buffer[trace_buffer_n].mc_n >= M68K_TRACE_MC_MAX) {
-    trace_buffer[trace_buffer_n].mc_n = 0;
+  m68k_trace_record_t *record;
+  int i;
+
+  record = &trace->file_buffer[trace->file_active][trace->file_buffer_n];
+  record->pc = entry->cpu.pc;
+  record->mc_n = 0;
+  for (i = 0; i < entry->mc_n && i < M68K_TRACE_RECORD_MC_MAX; i++) {
+    record->mc[i] = entry->mc[i];
+    record->mc_n++;
+  }
+  for (; i < M68K_TRACE_RECORD_MC_MAX; i++) {
+    record->mc[i] = 0;
+  }
+
+  trace->file_buffer_n++;
+  if (trace->file_buffer_n >= M68K_TRACE_FILE_BUFFER_SIZE) {
+    m68k_trace_file_swap(trace);
   }
 }
 
 
 
-void m68k_trace_op_mnemonic(const char *s)
+void m68k_trace_start(m68k_trace_t *trace, m68k_t *cpu)
 {
-  strncpy(trace_buffer[trace_buffer_n].op_mnemonic, s,
-    M68K_TRACE_OP_MNEMONIC_MAX);
+  memcpy(&trace->buffer[trace->buffer_n].cpu, cpu, sizeof(m68k_t));
+  trace->buffer[trace->buffer_n].mc_n = 0; /* Clear before use! */
 }
 
 
 
-void m68k_trace_op_src(const char *format, ...)
+void m68k_trace_mc(m68k_trace_t *trace, uint16_t mc)
 {
-  va_list args;
-  va_start(args, format);
-  vsnprintf(trace_buffer[trace_buffer_n].op_src,
-    M68K_TRACE_OP_SRC_MAX, format, args);
-  va_end(args);
+  m68k_trace_entry_t *entry = &trace->buffer[trace->buffer_n];
+
+  entry->mc[entry->mc_n] = mc;
+  entry->mc_n++;
+  if (entry->mc_n >= M68K_TRACE_MC_MAX) {
+    entry->mc_n = 0;
+  }
 }
 
 
 
-void m68k_trace_op_dst(const char *format, ...)
+void m68k_trace_end(m68k_trace_t *trace)
 {
-  va_list args;
-  va_start(args, format);
-  vsnprintf(trace_buffer[trace_buffer_n].op_dst,
-    M68K_TRACE_OP_DST_MAX, format, args);
-  va_end(args);
+  if (trace->file != NULL && trace->buffer[trace->buffer_n].mc_n != 0) {
+    m68k_trace_file_record(trace, &trace->buffer[trace->buffer_n]);
+  }
+
+  trace->buffer_n++;
+  if (trace->buffer_n >= trace->buffer_size) {
+    trace->buffer_n = 0;
+  }
 }
 
 
 
-void m68k_trace_end(void)
+m68k_trace_t *m68k_trace_create(int size)
 {
-  trace_buffer_n++;
-  if (trace_buffer_n >= M68K_TRACE_BUFFER_SIZE) {
-    trace_buffer_n = 0;
+  m68k_trace_t *trace;
+
+  if (size <= 0) {
+    size = M68K_TRACE_BUFFER_SIZE;
+  }
+
+  trace = calloc(1, sizeof(m68k_trace_t));
+  if (trace == NULL) {
+    return NULL;
+  }
+  trace->buffer = calloc(size, sizeof(m68k_trace_entry_t));
+  if (trace->buffer == NULL) {
+    free(trace);
+    return NULL;
   }
+  trace->buffer_size = size;
+  trace->buffer_n = 0;
+  trace->file = NULL;
+  trace->file_pending = -1;
+  pthread_mutex_init(&trace->file_mutex, NULL);
+  pthread_cond_init(&trace->file_cond, NULL);
+  return trace;
 }
 
 
 
-void m68k_trace_init(void)
+void m68k_trace_destroy(m68k_trace_t *trace)
 {
-  int i;
+  if (trace == NULL) {
+    return;
+  }
+  m68k_trace_file_close(trace);
+  pthread_mutex_destroy(&trace->file_mutex);
+  pthread_cond_destroy(&trace->file_cond);
+  free(trace->buffer);
+  free(trace);
+}
+
+
+
+static void m68k_trace_file_free(m68k_trace_t *trace)
+{
+  if (trace->file != NULL) {
+    fclose(trace->file);
+    trace->file = NULL;
+  }
+  free(trace->file_buffer[0]);
+  free(trace->file_buffer[1]);
+  trace->file_buffer[0] = NULL;
+  trace->file_buffer[1] = NULL;
+}
+
+
+
+int m68k_trace_file_open(m68k_trace_t *trace, const char *filename)
+{
+  if (trace->file != NULL) {
+    return -1; /* Already open. */
+  }
+
+  trace->file_buffer[0] =
+    malloc(M68K_TRACE_FILE_BUFFER_SIZE * sizeof(m68k_trace_record_t));
+  trace->file_buffer[1] =
+    malloc(M68K_TRACE_FILE_BUFFER_SIZE * sizeof(m68k_trace_record_t));
+  if (trace->file_buffer[0] == NULL || trace->file_buffer[1] == NULL) {
+    m68k_trace_file_free(trace);
+    return -1;
+  }
+
+  trace->file = fopen(filename, "wb");
+  if (trace->file == NULL) {
+    m68k_trace_file_free(trace);
+    return -1;
+  }
+
+  if (fwrite(M68K_TRACE_FILE_MAGIC, 1, M68K_TRACE_FILE_MAGIC_SIZE,
+    trace->file) != M68K_TRACE_FILE_MAGIC_SIZE) {
+    m68k_trace_file_free(trace);
+    return -1;
+  }
 
-  for (i = 0; i < M68K_TRACE_BUFFER_SIZE; i++) {
-    memset(&trace_buffer[i], 0, sizeof(m68k_trace_t));
+  trace->file_buffer_n = 0;
+  trace->file_active = 0;
+  trace->file_pending = -1;
+  trace->file_quit = false;
+  if (pthread_create(&trace->file_thread, NULL,
+    m68k_trace_file_writer, trace) != 0) {
+    m68k_trace_file_free(trace);
+    return -1;
   }
-  trace_buffer_n = 0;
+
+  return 0;
 }
 
 
 
-static void m68k_trace_print(FILE *fh, m68k_trace_t *trace, bool compact)
+void m68k_trace_file_close(m68k_trace_t *trace)
+{
+  if (trace->file == NULL) {
+    return;
+  }
+
+  if (trace->file_buffer_n > 0) {
+    m68k_trace_file_swap(trace);
+  }
+
+  pthread_mutex_lock(&trace->file_mutex);
+  trace->file_quit = true;
+  pthread_cond_broadcast(&trace->file_cond);
+  pthread_mutex_unlock(&trace->file_mutex);
+  pthread_join(trace->file_thread, NULL);
+
+  m68k_trace_file_free(trace);
+}
+
+
+
+static void m68k_trace_print(FILE *fh, m68k_trace_entry_t *trace,
+  m68k_disasm_t *disasm, bool compact)
 {
   int i;
 
@@ -120,6 +287,8 @@ static void m68k_trace_print(FILE *fh, m68k_trace_t *trace, bool compact)
     }
 
   } else {
+    m68k_cc_flush(&trace->cpu); /* Snapshot may hold pending flags. */
+
     fprintf(fh, "D0-7 %08x %08x %08x %08x %08x %08x %08x %08x\n",
       trace->cpu.d[0],
       trace->cpu.d[1],
@@ -169,32 +338,45 @@ static void m68k_trace_print(FILE *fh, m68k_trace_t *trace, bool compact)
     }
   }
 
-  if (trace->op_dst[0] == '\0' && trace->op_src[0] == '\0') {
-    fprintf(fh, "%s\n", trace->op_mnemonic);
-  } else if (trace->op_src[0] == '\0') {
-    fprintf(fh, "%s %s\n", trace->op_mnemonic, trace->op_dst);
-  } else if (trace->op_dst[0] == '\0') {
-    fprintf(fh, "%s %s\n", trace->op_mnemonic, trace->op_src);
+  if (disasm->dst[0] == '\0' && disasm->src[0] == '\0') {
+    fprintf(fh, "%s\n", disasm->mnemonic);
+  } else if (disasm->src[0] == '\0') {
+    fprintf(fh, "%s %s\n", disasm->mnemonic, disasm->dst);
+  } else if (disasm->dst[0] == '\0') {
+    fprintf(fh, "%s %s\n", disasm->mnemonic, disasm->src);
   } else {
     fprintf(fh, "%s %s, %s\n",
-      trace->op_mnemonic, trace->op_src, trace->op_dst);
+      disasm->mnemonic, disasm->src, disasm->dst);
   }
 }
 
 
 
-void m68k_trace_dump(FILE *fh, bool compact)
+static void m68k_trace_dump_entry(FILE *fh, m68k_trace_entry_t *trace,
+  bool compact)
+{
+  m68k_disasm_t disasm;
+
+  if (trace->mc_n == 0) {
+    return;
+  }
+
+  m68k_disasm(&disasm, trace->cpu.pc, trace->mc, trace->mc_n);
+  if (disasm.mnemonic[0] != '\0') {
+    m68k_trace_print(fh, trace, &disasm, compact);
+  }
+}
+
+
+
+void m68k_trace_dump(m68k_trace_t *trace, FILE *fh, bool compact)
 {
   int i;
-  for (i = trace_buffer_n; i < M68K_TRACE_BUFFER_SIZE; i++) {
-    if (trace_buffer[i].mc_n != 0 && trace_buffer[i].op_mnemonic[0] != '\0') {
-      m68k_trace_print(fh, &trace_buffer[i], compact);
-    }
+  for (i = trace->buffer_n; i < trace->buffer_size; i++) {
+    m68k_trace_dump_entry(fh, &trace->buffer[i], compact);
   }
-  for (i = 0; i < trace_buffer_n; i++) {
-    if (trace_buffer[i].mc_n != 0 && trace_buffer[i].op_mnemonic[0] != '\0') {
-      m68k_trace_print(fh, &trace_buffer[i], compact);
-    }
+  for (i = 0; i < trace->buffer_n; i++) {
+    m68k_trace_dump_entry(fh, &trace->buffer[i], compact);
   }
 }
 
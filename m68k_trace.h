@@ -1,20 +1,38 @@
 #ifndef _M68K_TRACE_H
 #define _M68K_TRACE_H
 
-#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include "m68k.h"
 
-void m68k_trace_start(m68k_t *cpu);
-void m68k_trace_mc(uint16_t mc);
-void m68k_trace_op_mnemonic(const char *s);
-void m68k_trace_op_src(const char *format, ...);
-void m68k_trace_op_dst(const char *format, ...);
-void m68k_trace_end(void);
+#define M68K_TRACE_BUFFER_SIZE 64 /* Default depth of the in-memory ring. */
 
-void m68k_trace_init(void);
-void m68k_trace_dump(FILE *fh, bool compact);
+#define M68K_TRACE_FILE_MAGIC "M68KTRC1"
+#define M68K_TRACE_FILE_MAGIC_SIZE 8
+
+/* Longest 68000 instruction is 5 words, e.g. MOVE.L #imm, (xxx).L */
+#define M68K_TRACE_RECORD_MC_MAX 5
+
+/* Fixed-size record streamed to the trace file in host byte order,
+   following the magic. Disassembled offline by the 'tracedump' tool. */
+typedef struct m68k_trace_record_s {
+  uint32_t pc;
+  uint16_t mc_n;
+  uint16_t mc[M68K_TRACE_RECORD_MC_MAX];
+} m68k_trace_record_t;
+
+/* Trace ring and file writer of one CPU, see m68k_t 'trace_state'. */
+typedef struct m68k_trace_s m68k_trace_t;
+
+void m68k_trace_start(m68k_trace_t *trace, m68k_t *cpu);
+void m68k_trace_mc(m68k_trace_t *trace, uint16_t mc);
+void m68k_trace_end(m68k_trace_t *trace);
+
+m68k_trace_t *m68k_trace_create(int size);
+void m68k_trace_destroy(m68k_trace_t *trace);
+int m68k_trace_file_open(m68k_trace_t *trace, const char *filename);
+void m68k_trace_file_close(m68k_trace_t *trace);
+void m68k_trace_dump(m68k_trace_t *trace, FILE *fh, bool compact);
 
 #endif /* _M68K_TRACE_H */
@@ -5,38 +5,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "batch.h"
 #include "console.h"
 #include "debugger.h"
+#include "emu.h"
+#include "expect.h"
 #include "m68k.h"
 #include "m68k_trace.h"
 #include "mem.h"
 #include "panic.h"
 #include "ramdisk.h"
+#include "server.h"
+#include "snapshot.h"
 
 
 
 #define CPM_BIOS_DEFAULT_FILENAME "emubios.srec"
 #define CPM_BIOS_DEFAULT_ENTRY_POINT 0xFF0000
 
-static m68k_t cpu;
-static mem_t mem;
-static ramdisk_t ramdisk;
+/* Instructions executed between checks for debugger break. */
+#define CPU_RUN_BUDGET 100000
 
-static bool debugger_break = false;
-static char panic_msg[80];
+static emu_t *emu = NULL;
 
-
-
-void panic(const char *format, ...)
-{
-  va_list args;
-
-  va_start(args, format);
-  vsnprintf(panic_msg, sizeof(panic_msg), format, args);
-  va_end(args);
-
-  debugger_break = true;
-}
+static bool ramdisk_auto_save = false;
+static char *snapshot_filename = NULL;
+static char *server_path = NULL;
+static bool server_job = false;
+static expect_t expect;
 
 
 
@@ -44,149 +40,50 @@ static void sig_handler(int sig)
 {
   switch (sig) {
   case SIGINT:
-    debugger_break = true;
+    if (emu != NULL) {
+      emu->debugger_break = true;
+    }
     return;
   }
 }
 
 
 
-static void trap_hook(uint32_t d[8])
+static void ramdisk_exit(void)
 {
-  static char filename[16];
-  static char lc_filename[16];
-  static FILE *fh;
-  int c;
   int i;
-  int n;
-
-  switch (d[0]) {
-  case 1: /* Console Status */
-    d[0] = console_status();
-    break;
-
-  case 2: /* Console Read */
-    d[0] = console_read();
-    break;
-
-  case 3: /* Console Write */
-    console_write(d[1]);
-    break;
-
-  case 4: /* RAM Disk Select */
-    d[0] = ramdisk_select(&ramdisk, d[1]);
-    break;
-
-  case 5: /* RAM Disk Track Set */
-    ramdisk_track_set(&ramdisk, d[1]);
-    break;
-
-  case 6: /* RAM Disk Sector Set */
-    ramdisk_sector_set(&ramdisk, d[1]);
-    break;
-
-  case 7: /* RAM Disk DMA Set */
-    ramdisk_dma_set(&ramdisk, d[1]);
-    break;
-
-  case 8: /* RAM Disk Read */
-    ramdisk_read(&ramdisk, &mem);
-    break;
+  int result;
 
-  case 9: /* RAM Disk Write */
-    ramdisk_write(&ramdisk, &mem);
-    break;
-
-  case 10: /* Remote Open */
-    memset(filename, '\0', sizeof(filename));
-    memset(lc_filename, '\0', sizeof(lc_filename));
-    n = 0;
+  if (emu == NULL || ! ramdisk_auto_save) {
+    return;
+  }
 
-    for (i = 0; i < 8; i++) {
-      c = mem_read_byte(&mem, d[1] + i);
-      if (c == 0x20) {
-        break;
+  for (i = 0; i < RAMDISK_MAX; i++) {
+    if (ramdisk_dirty(&emu->ramdisk, i) &&
+      emu->ramdisk.filename[i][0] != '\0') {
+      result = ramdisk_save(&emu->ramdisk, i, NULL);
+      if (result != 0) {
+        fprintf(stdout, "RAM disk %c save error: %d\n", i + 0x41, result);
       }
-      filename[n] = c;
-      lc_filename[n] = tolower(c);
-      n++;
     }
+  }
+}
 
-    for (i = 0; i < 3; i++) {
-      c = mem_read_byte(&mem, d[1] + 8 + i);
-      if (c == 0x20) {
-        break;
-      }
-      if (i == 0) { /* Add dot if there is an extension. */
-        filename[n] = '.';
-        lc_filename[n] = '.';
-        n++;
-      }
-      filename[n] = c;
-      lc_filename[n] = tolower(c);
-      n++;
-    }
 
-    fh = NULL;
-    if (d[2] == 'w') {
-      fh = fopen(filename, "wb");
-    } else if (d[2] == 'r') {
-      fh = fopen(filename, "rb");
-      if (fh == NULL && errno == ENOENT) {
-        fh = fopen(lc_filename, "rb"); /* Fallback to lowercase. */
-      }
-    }
 
-    if (fh == NULL) {
-      d[0] = 0xFF; /* Error */
-    } else {
-      d[0] = 0x00; /* OK */
-    }
-    break;
-
-  case 11: /* Remote Write */
-    if (fh == NULL) {
-      d[0] = 0xFF; /* Error */
-    } else {
-      for (i = 0; i < 128; i++) {
-        fputc(mem_read_byte(&mem, d[1] + i), fh);
-      }
-      d[0] = 0x00; /* OK */
-    }
-    break;
-
-  case 12: /* Remote Read */
-    if (fh == NULL) {
-      d[0] = 0xFF; /* Error */
-    } else {
-      d[0] = 0x00; /* Maybe More */
-      for (i = 0; i < 128; i++) {
-        c = fgetc(fh);
-        if (c == EOF) {
-          if (i == 0) {
-            d[0] = 0x01; /* Done */
-            break;
-          }
-          c = '\0';
-        }
-        mem_write_byte(&mem, d[1] + i, c);
-      }
-    }
-    break;
+static void trace_exit(void)
+{
+  if (emu != NULL) {
+    m68k_trace_file_close(emu->trace);
+  }
+}
 
-  case 13: /* Remote Close */
-    if (fh != NULL) {
-      fclose(fh);
-    }
-    fh = NULL;
-    break;
 
-  case 14: /* Quit */
-    exit(EXIT_SUCCESS);
-    break;
 
-  default:
-    break;
+static void console_exit(void)
+{
+  if (emu != NULL) {
+    console_flush(&emu->console);
   }
 }
 
@@ -199,10 +96,23 @@ static void display_help(const char *progname)
     "  -h        Display this help.\n"
     "  -d        Enter debugger on start.\n"
     "  -w        Enable warp mode to maximize host CPU usage.\n"
+    "  -j        Enable chaining of cached blocks for faster execution.\n"
+    "  -t        Enable CPU trace from start, at the cost of speed.\n"
+    "  -n NUM    Keep NUM instructions in the CPU trace (default %d).\n"
+    "  -T FILE   Stream binary CPU trace to FILE, implies -t.\n"
+    "  -s        Write RAM disk changes straight through to the images.\n"
+    "  -a        Save changed RAM disks back to their images on exit.\n"
+    "  -S FILE   Save snapshot to FILE once injected input is consumed.\n"
+    "  -R FILE   Restore snapshot from FILE instead of booting.\n"
+    "  -F PATH   Serve jobs on socket PATH once injected input is consumed.\n"
+    "  -M FILE   Run the jobs listed in manifest FILE, then exit.\n"
+    "  -P NUM    Run manifest jobs on NUM threads (default one per CPU).\n"
+    "  -L SECS   Stop manifest jobs after SECS seconds (default %d, 0: none).\n"
     "  -b FILE   Use S-record FILE as CP/M and BIOS instead of the default.\n"
     "  -e ADDR   Entry point at (hex) ADDR instead of the default.\n"
     "  -i STR    Inject STR as input (CP/M commands) to console.\n"
-    "  -I FILE   Inject text from FILE as input (CP/M commands) to console.\n"
+    "  -I FILE   Inject text from FILE, pipe or FIFO as input to console.\n"
+    "  -x FILE   Drive the console with expect script FILE.\n"
 #if RAMDISK_MAX > 1
     "  -B FILE   Load FILE into RAM disk B.\n"
 #endif
@@ -212,7 +122,7 @@ static void display_help(const char *progname)
 #if RAMDISK_MAX > 3
     "  -D FILE   Load FILE into RAM disk D.\n"
 #endif
-    "\n");
+    "\n", M68K_TRACE_BUFFER_SIZE, BATCH_TIMEOUT_DEFAULT_S);
   fprintf(stdout,
     "Default CP/M and BIOS: '%s' @ 0x%06x\n",
       CPM_BIOS_DEFAULT_FILENAME, CPM_BIOS_DEFAULT_ENTRY_POINT);
@@ -233,27 +143,90 @@ int main(int argc, char *argv[])
   char *inject_string = NULL;
   char *inject_filename = NULL;
   char *cpm_bios_filename = CPM_BIOS_DEFAULT_FILENAME;
+  char *trace_filename = NULL;
+  char *restore_filename = NULL;
+  char *manifest_filename = NULL;
+  char *expect_filename = NULL;
+  int manifest_workers = 0;
+  double manifest_timeout = BATCH_TIMEOUT_DEFAULT_S;
+  batch_config_t batch_config;
+  int result;
+  bool block_chain = false;
+  bool cpu_trace = false;
+  bool debugger_start = false;
+  bool warp_mode = false;
+  bool ramdisk_write_through = false;
+  int trace_size = M68K_TRACE_BUFFER_SIZE;
   uint32_t cpm_bios_entry_point = CPM_BIOS_DEFAULT_ENTRY_POINT;
 
   for (i = 0; i < RAMDISK_MAX; i++) {
     ramdisk_filename[i] = NULL;
   }
 
-  panic_msg[0] = '\0';
   signal(SIGINT, sig_handler);
 
-  while ((c = getopt(argc, argv, "hdwb:e:i:I:B:C:D:")) != -1) {
+  while ((c = getopt(argc, argv,
+    "hdwjtn:T:saS:R:F:M:P:L:b:e:i:I:x:B:C:D:")) != -1) {
     switch (c) {
     case 'h':
       display_help(argv[0]);
       return EXIT_SUCCESS;
 
     case 'd':
-      debugger_break = true;
+      debugger_start = true;
       break;
 
     case 'w':
-      console_warp_mode_toggle();
+      warp_mode = true;
+      break;
+
+    case 'j':
+      block_chain = true;
+      break;
+
+    case 't':
+      cpu_trace = true;
+      break;
+
+    case 'n':
+      trace_size = atoi(optarg);
+      break;
+
+    case 'T':
+      trace_filename = optarg;
+      cpu_trace = true;
+      break;
+
+    case 's':
+      ramdisk_write_through = true;
+      break;
+
+    case 'a':
+      ramdisk_auto_save = true;
+      break;
+
+    case 'S':
+      snapshot_filename = optarg;
+      break;
+
+    case 'R':
+      restore_filename = optarg;
+      break;
+
+    case 'F':
+      server_path = optarg;
+      break;
+
+    case 'M':
+      manifest_filename = optarg;
+      break;
+
+    case 'P':
+      manifest_workers = atoi(optarg);
+      break;
+
+    case 'L':
+      manifest_timeout = atof(optarg);
       break;
 
     case 'b':
@@ -272,6 +245,10 @@ int main(int argc, char *argv[])
       inject_filename = optarg;
       break;
 
+    case 'x':
+      expect_filename = optarg;
+      break;
+
 #if RAMDISK_MAX > 1
     case 'B':
       ramdisk_filename[1] = optarg;
@@ -301,16 +278,94 @@ int main(int argc, char *argv[])
     ramdisk_filename[0] = argv[optind]; /* Disk A */
   }
 
-  m68k_trace_init();
-  console_init();
-  mem_init(&mem);
-  ramdisk_init(&ramdisk);
-  m68k_init(&cpu);
-  cpu.trap_15_hook = trap_hook;
+  if (restore_filename != NULL && ramdisk_write_through) {
+    fprintf(stdout, "Restoring a snapshot cannot be combined with -s!\n");
+    return EXIT_FAILURE;
+  }
+
+  /* Jobs would all write to the same images at once. */
+  if (server_path != NULL && (ramdisk_write_through || ramdisk_auto_save)) {
+    fprintf(stdout, "Serving jobs cannot be combined with -s or -a!\n");
+    return EXIT_FAILURE;
+  }
+
+  /* Jobs get their input from the connection. */
+  if (server_path != NULL && expect_filename != NULL) {
+    fprintf(stdout, "Serving jobs cannot be combined with -x!\n");
+    return EXIT_FAILURE;
+  }
+
+  if (manifest_filename != NULL) {
+    /* Jobs run unattended, each on its own copy of the images. */
+    if (debugger_start || cpu_trace || ramdisk_write_through ||
+      ramdisk_auto_save || snapshot_filename != NULL ||
+      restore_filename != NULL || server_path != NULL ||
+      expect_filename != NULL) {
+      fprintf(stdout, "Running jobs cannot be combined with "
+        "-d, -t, -T, -s, -a, -S, -R, -F or -x!\n");
+      return EXIT_FAILURE;
+    }
+
+    batch_config.cpm_bios_filename = cpm_bios_filename;
+    batch_config.cpm_bios_entry_point = cpm_bios_entry_point;
+    batch_config.inject_filename = inject_filename;
+    batch_config.inject_string = inject_string;
+    batch_config.block_chain = block_chain;
+    batch_config.workers = manifest_workers;
+    batch_config.timeout = manifest_timeout;
+    for (i = 0; i < RAMDISK_MAX; i++) {
+      batch_config.ramdisk_filename[i] = ramdisk_filename[i];
+    }
+
+    signal(SIGINT, SIG_DFL); /* No debugger to break into. */
+    result = batch_run(manifest_filename, &batch_config);
+    if (result < 0) {
+      fprintf(stdout, "Running jobs from manifest '%s' failed: %d\n",
+        manifest_filename, result);
+      return EXIT_FAILURE;
+    }
+    return (result == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  emu = emu_create(trace_size);
+  if (emu == NULL) {
+    fprintf(stdout, "Creating emulator with CPU trace of %d entries failed!\n",
+      trace_size);
+    return EXIT_FAILURE;
+  }
+
+  if (trace_filename != NULL) {
+    if (m68k_trace_file_open(emu->trace, trace_filename) != 0) {
+      fprintf(stdout, "Opening trace file '%s' failed!\n", trace_filename);
+      return EXIT_FAILURE;
+    }
+    atexit(trace_exit);
+  }
+
+  /* Registered before the console, so it runs after the terminal is reset. */
+  atexit(ramdisk_exit);
+  console_terminal_init();
+  atexit(console_exit); /* Runs first, while the terminal is still set. */
+  if (warp_mode) {
+    console_warp_mode_toggle(&emu->console);
+  }
+  emu->ramdisk.write_through = ramdisk_write_through;
+  emu->cpu.chain = block_chain;
+  emu->cpu.trace = cpu_trace;
+  emu->debugger_break = debugger_start;
+  emu->idle_break = (snapshot_filename != NULL || server_path != NULL);
+
+  if (restore_filename != NULL) {
+    if (snapshot_load(restore_filename, emu) != 0) {
+      fprintf(stdout, "Restoring snapshot '%s' failed!\n", restore_filename);
+      return EXIT_FAILURE;
+    }
+  }
 
+  /* Images given explicitly replace any restored RAM disk contents. */
   for (i = 0; i < RAMDISK_MAX; i++) {
     if (ramdisk_filename[i] != NULL) {
-      if (ramdisk_load(&ramdisk, i, ramdisk_filename[i]) != 0) {
+      if (ramdisk_load(&emu->ramdisk, i, ramdisk_filename[i]) != 0) {
         fprintf(stdout, "Loading RAM disk %c file '%s' failed!\n",
           i + 0x41, ramdisk_filename[i]);
         return EXIT_FAILURE;
@@ -318,48 +373,143 @@ int main(int argc, char *argv[])
     }
   }
 
-  if (mem_load_srec(&mem, cpm_bios_filename) != 0) {
-    fprintf(stdout, "Loading CP/M and BIOS file '%s' failed!\n",
-      cpm_bios_filename);
-    return EXIT_FAILURE;
+  if (restore_filename == NULL) {
+    if (mem_load_srec(&emu->mem, cpm_bios_filename) != 0) {
+      fprintf(stdout, "Loading CP/M and BIOS file '%s' failed!\n",
+        cpm_bios_filename);
+      return EXIT_FAILURE;
+    }
+    emu->cpu.pc = cpm_bios_entry_point;
   }
 
   if (inject_filename != NULL) {
-    if (console_inject_file(inject_filename) != 0) {
+    if (console_inject_file(&emu->console, inject_filename) != 0) {
       fprintf(stdout, "Injecting file '%s' failed!\n", inject_filename);
       return EXIT_FAILURE;
     }
   }
 
   if (inject_string != NULL) {
-    while (*inject_string != '\0') {
-      console_inject(*inject_string);
-      inject_string++;
+    if (console_inject_string(&emu->console, inject_string) != 0) {
+      fprintf(stdout, "Injecting string failed!\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (expect_filename != NULL) {
+    expect_init(&expect);
+    result = expect_load(&expect, expect_filename);
+    if (result == -2) {
+      fprintf(stdout, "Syntax error in expect script '%s' on line %d!\n",
+        expect_filename, expect.line);
+      return EXIT_FAILURE;
+    } else if (result != 0) {
+      fprintf(stdout, "Loading expect script '%s' failed!\n",
+        expect_filename);
+      return EXIT_FAILURE;
     }
+    emu->expect = &expect;
+    emu->console.input = NULL; /* Keyboard is held back until it is done. */
+    expect_start(&expect, &emu->console);
   }
 
-  cpu.pc = cpm_bios_entry_point;
+  if (console_input_start(&emu->console) != 0) {
+    fprintf(stdout, "Starting console input thread failed!\n");
+    return EXIT_FAILURE;
+  }
 
   while (1) {
-    if (debugger_break) {
+    if (emu->quit) {
+      exit(EXIT_SUCCESS);
+    }
+
+    if (emu->expect != NULL && expect.state != EXPECT_RUNNING) {
+      emu->expect = NULL;
+      switch (expect.state) {
+      case EXPECT_DONE:
+        emu->console.input = stdin;
+        if (console_input_start(&emu->console) != 0) {
+          panic(emu, "Starting console input thread failed!\n");
+        }
+        break;
+
+      case EXPECT_TIMEOUT:
+        console_flush(&emu->console);
+        fprintf(stdout, "\nExpect script '%s' timed out on line %d!\n",
+          expect_filename, expect.step[expect.current].line);
+        exit(expect.exit_code);
+
+      case EXPECT_STUCK:
+        console_flush(&emu->console);
+        fprintf(stdout, "\nExpect script '%s' stuck on line %d, "
+          "CP/M waits for input!\n",
+          expect_filename, expect.step[expect.current].line);
+        exit(expect.exit_code);
+
+      default:
+        exit(expect.exit_code);
+      }
+    }
+
+    if (emu->idle) {
+      emu->idle = false;
+      if (server_job) {
+        exit(EXIT_SUCCESS); /* Job done, CP/M wants more input. */
+
+      } else if (snapshot_filename != NULL) {
+        if (snapshot_save(snapshot_filename, emu) != 0) {
+          panic(emu, "Saving snapshot '%s' failed!\n", snapshot_filename);
+        }
+        snapshot_filename = NULL;
+
+      } else if (server_path != NULL) {
+        console_flush(&emu->console); /* Or every job repeats it. */
+        console_input_stop(&emu->console); /* Threads do not survive fork. */
+        console_pause();
+        switch (server_accept(server_path, &emu->console)) {
+        case 0: /* Forked job, continue from the prompt with its input. */
+          server_job = true;
+          break;
+        case 1: /* Interrupted, let the debugger have a look. */
+          console_resume();
+          if (console_input_start(&emu->console) != 0) {
+            panic(emu, "Starting console input thread failed!\n");
+          }
+          break;
+        default:
+          panic(emu, "Serving jobs on '%s' failed!\n", server_path);
+          break;
+        }
+      }
+      emu->idle_break = (snapshot_filename != NULL || server_path != NULL);
+    }
+
+    if (emu->debugger_break) {
+      console_flush(&emu->console);
+      console_input_stop(&emu->console); /* The debugger reads it now. */
       console_pause();
-      if (panic_msg[0] != '\0') {
-        fprintf(stdout, "%s", panic_msg);
-        panic_msg[0] = '\0';
+      if (emu->panic_msg[0] != '\0') {
+        fprintf(stdout, "%s", emu->panic_msg);
+        emu->panic_msg[0] = '\0';
       }
-      debugger_break = debugger(&cpu, &mem, &ramdisk);
-      if (! debugger_break) {
+      emu->debugger_break = debugger(emu);
+      if (! emu->debugger_break) {
         console_resume();
+        if (console_input_start(&emu->console) != 0) {
+          panic(emu, "Starting console input thread failed!\n");
+        }
       }
     }
 
-    m68k_execute(&cpu, &mem);
-
-#ifdef CPU_BREAKPOINT
-    if ((int32_t)cpu.pc == debugger_breakpoint_pc) {
-      panic("Breakpoint\n");
+    /* Single step when coming from the debugger. */
+    if (m68k_run(&emu->cpu, &emu->mem,
+      emu->debugger_break ? 1 : CPU_RUN_BUDGET) == M68K_RUN_BREAKPOINT) {
+      panic(emu, "Breakpoint\n");
+    }
+    console_flush_timer(&emu->console);
+    if (emu->expect != NULL) {
+      expect_timer(emu->expect);
     }
-#endif /* CPU_BREAKPOINT */
   }
 
   return EXIT_SUCCESS;
@@ -2,101 +2,102 @@
 #include <ctype.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 
 
-uint8_t mem_read_byte(mem_t *mem, uint32_t address)
+/* Copy bytes in guest order, within the address space. */
+static inline void mem_copy_out(mem_t *mem, uint32_t address, uint8_t *data,
+  uint32_t size)
 {
-  return mem->ram[address & 0xFFFFFF];
-}
-
-
+#if MEM_BYTE_XOR == 0
+  memcpy(data, &mem->ram[address], size);
+#else
+  uint32_t i;
 
-uint16_t mem_read_word(mem_t *mem, uint32_t address, bool *error)
-{
-  address &= 0xFFFFFF;
-  if (address % 2 != 0) {
-    *error = true;
-    return 0;
-  } else {
-    return mem->ram[address+1] |
-          (mem->ram[address] << 8);
+  for (i = 0; i < size; i++) {
+    data[i] = mem->ram[(address + i) ^ MEM_BYTE_XOR];
   }
+#endif
 }
 
 
 
-uint32_t mem_read_long(mem_t *mem, uint32_t address, bool *error)
+static inline void mem_copy_in(mem_t *mem, uint32_t address,
+  const uint8_t *data, uint32_t size)
 {
-  address &= 0xFFFFFF;
-  if (address % 2 != 0) {
-    *error = true;
-    return 0;
-  } else {
-    if (address == 0xFFFFFE) {
-      return mem->ram[0x000001]         |
-            (mem->ram[0x000000]  << 8)  |
-            (mem->ram[address+1] << 16) |
-            (mem->ram[address]   << 24);
-    } else {
-      return mem->ram[address+3]        |
-            (mem->ram[address+2] << 8)  |
-            (mem->ram[address+1] << 16) |
-            (mem->ram[address]   << 24);
-    }
+#if MEM_BYTE_XOR == 0
+  memcpy(&mem->ram[address], data, size);
+#else
+  uint32_t i;
+
+  for (i = 0; i < size; i++) {
+    mem->ram[(address + i) ^ MEM_BYTE_XOR] = data[i];
   }
+#endif
 }
 
 
 
-void mem_write_byte(mem_t *mem, uint32_t address, uint8_t value)
+void mem_read_block(mem_t *mem, uint32_t address, uint8_t *data, uint32_t size)
 {
-  mem->ram[address & 0xFFFFFF] = value;
+  uint32_t n;
+
+  while (size > 0) {
+    address &= 0xFFFFFF;
+    n = MEM_MAX - address; /* Split where the address space wraps. */
+    if (n > size) {
+      n = size;
+    }
+    mem_copy_out(mem, address, data, n);
+    address += n;
+    data += n;
+    size -= n;
+  }
 }
 
 
 
-void mem_write_word(mem_t *mem, uint32_t address, uint16_t value, bool *error)
+void mem_write_block(mem_t *mem, uint32_t address, const uint8_t *data,
+  uint32_t size)
 {
-  address &= 0xFFFFFF;
-  if (address % 2 != 0) {
-    *error = true;
-  } else {
-    mem->ram[address]   = (value >> 8) & 0xFF;
-    mem->ram[address+1] =  value       & 0xFF;
+  uint32_t n;
+  uint32_t page;
+
+  mem->write_n++;
+  while (size > 0) {
+    address &= 0xFFFFFF;
+    n = MEM_MAX - address; /* Split where the address space wraps. */
+    if (n > size) {
+      n = size;
+    }
+    for (page = address >> MEM_PAGE_SHIFT;
+      page <= (address + n - 1) >> MEM_PAGE_SHIFT; page++) {
+      mem_code_write(mem, page << MEM_PAGE_SHIFT);
+    }
+    mem_copy_in(mem, address, data, n);
+    address += n;
+    data += n;
+    size -= n;
   }
+  memcpy(&mem->ram[MEM_MAX], &mem->ram[0], MEM_GUARD); /* Keep in step. */
 }
 
 
 
-void mem_write_long(mem_t *mem, uint32_t address, uint32_t value, bool *error)
+void mem_code_mark(mem_t *mem, uint32_t address)
 {
-  address &= 0xFFFFFF;
-  if (address % 2 != 0) {
-    *error = true;
-  } else {
-    if (address == 0xFFFFFE) {
-      mem->ram[address  ] = (value >> 24) & 0xFF;
-      mem->ram[address+1] = (value >> 16) & 0xFF;
-      mem->ram[0x000000]  = (value >> 8)  & 0xFF;
-      mem->ram[0x000001]  =  value        & 0xFF;
-    } else {
-      mem->ram[address  ] = (value >> 24) & 0xFF;
-      mem->ram[address+1] = (value >> 16) & 0xFF;
-      mem->ram[address+2] = (value >> 8)  & 0xFF;
-      mem->ram[address+3] =  value        & 0xFF;
-    }
-  }
+  mem->code[(address & 0xFFFFFF) >> MEM_PAGE_SHIFT] = true;
 }
 
 
 
 void mem_init(mem_t *mem)
 {
-  int i;
-  for (i = 0; i < MEM_MAX; i++) {
-    mem->ram[i] = 0x0;
-  }
+  memset(mem->ram, 0, sizeof(mem->ram));
+  memset(mem->code, 0, sizeof(mem->code));
+  memset(mem->code_gen, 0, sizeof(mem->code_gen));
+  mem->write_n = 0;
 }
 
 
@@ -4,23 +4,158 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #define MEM_MAX 0x1000000 /* 24-bit */
+#define MEM_PAGE_SHIFT 8
+#define MEM_PAGES (MEM_MAX >> MEM_PAGE_SHIFT)
+
+/* The first bytes are mirrored after the end, so a long word at 0xFFFFFE,
+   where the address space wraps, can be read like any other. */
+#define MEM_GUARD 2
+
+/* Guest memory is big-endian, converted with single loads and stores.
+   Built with MEM_WORD_SWAP it is kept as host-endian words instead, so
+   words, like every instruction fetch, need no conversion at all, longs
+   only have their halves swapped, and bytes are found at the address
+   XOR'ed with MEM_BYTE_XOR. */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define MEM_BYTE_XOR 0
+#define MEM_WORD(x) (x)
+#define MEM_LONG(x) (x)
+#elif defined(MEM_WORD_SWAP)
+#define MEM_BYTE_XOR 1
+#define MEM_WORD(x) (x)
+#define MEM_LONG(x) (((x) << 16) | ((x) >> 16))
+#else
+#define MEM_BYTE_XOR 0
+#define MEM_WORD(x) __builtin_bswap16(x)
+#define MEM_LONG(x) __builtin_bswap32(x)
+#endif
 
 typedef struct mem_s {
-  uint8_t ram[MEM_MAX];
+  uint8_t ram[MEM_MAX + MEM_GUARD];
+  bool code[MEM_PAGES]; /* Page has been decoded by the CPU. */
+  uint32_t code_gen[MEM_PAGES]; /* Bumped on write to a code page. */
+  uint32_t write_n; /* Bumped on every write, to recognize idle loops. */
 } mem_t;
 
-uint8_t mem_read_byte(mem_t *mem, uint32_t address);
-uint16_t mem_read_word(mem_t *mem, uint32_t address, bool *error);
-uint32_t mem_read_long(mem_t *mem, uint32_t address, bool *error);
-void mem_write_byte(mem_t *mem, uint32_t address, uint8_t value);
-void mem_write_word(mem_t *mem, uint32_t address, uint16_t value, bool *error);
-void mem_write_long(mem_t *mem, uint32_t address, uint32_t value, bool *error);
+void mem_read_block(mem_t *mem, uint32_t address, uint8_t *data, uint32_t size);
+void mem_write_block(mem_t *mem, uint32_t address, const uint8_t *data,
+  uint32_t size);
 
+void mem_code_mark(mem_t *mem, uint32_t address);
 void mem_init(mem_t *mem);
 int mem_load_binary(mem_t *mem, const char *filename, uint32_t address);
 int mem_load_srec(mem_t *mem, const char *filename);
 void mem_dump(FILE *fh, mem_t *mem, uint32_t start, uint32_t end);
 
+
+
+static inline void mem_code_write(mem_t *mem, uint32_t address)
+{
+  uint32_t page = address >> MEM_PAGE_SHIFT;
+  if (mem->code[page]) {
+    mem->code[page] = false;
+    mem->code_gen[page]++;
+  }
+}
+
+
+
+static inline uint8_t mem_read_byte(mem_t *mem, uint32_t address)
+{
+  return mem->ram[(address & 0xFFFFFF) ^ MEM_BYTE_XOR];
+}
+
+
+
+static inline uint16_t mem_read_word(mem_t *mem, uint32_t address,
+  bool *error)
+{
+  uint16_t value;
+
+  address &= 0xFFFFFF;
+  if (address % 2 != 0) {
+    *error = true;
+    return 0;
+  }
+  memcpy(&value, &mem->ram[address], sizeof(value));
+  return MEM_WORD(value);
+}
+
+
+
+static inline uint32_t mem_read_long(mem_t *mem, uint32_t address,
+  bool *error)
+{
+  uint32_t value;
+
+  address &= 0xFFFFFF;
+  if (address % 2 != 0) {
+    *error = true;
+    return 0;
+  }
+  memcpy(&value, &mem->ram[address], sizeof(value)); /* Maybe the guard. */
+  return MEM_LONG(value);
+}
+
+
+
+static inline void mem_write_byte(mem_t *mem, uint32_t address,
+  uint8_t value)
+{
+  address &= 0xFFFFFF;
+  mem_code_write(mem, address);
+  address ^= MEM_BYTE_XOR;
+  mem->ram[address] = value;
+  if (address < MEM_GUARD) {
+    mem->ram[MEM_MAX + address] = value;
+  }
+  mem->write_n++;
+}
+
+
+
+static inline void mem_write_word(mem_t *mem, uint32_t address,
+  uint16_t value, bool *error)
+{
+  address &= 0xFFFFFF;
+  if (address % 2 != 0) {
+    *error = true;
+    return;
+  }
+  mem_code_write(mem, address);
+  value = MEM_WORD(value);
+  memcpy(&mem->ram[address], &value, sizeof(value));
+  if (address < MEM_GUARD) {
+    memcpy(&mem->ram[MEM_MAX], &mem->ram[0], MEM_GUARD);
+  }
+  mem->write_n++;
+}
+
+
+
+static inline void mem_write_long(mem_t *mem, uint32_t address,
+  uint32_t value, bool *error)
+{
+  address &= 0xFFFFFF;
+  if (address % 2 != 0) {
+    *error = true;
+    return;
+  }
+  mem_code_write(mem, address);
+  mem_code_write(mem, (address + 3) & 0xFFFFFF);
+  value = MEM_LONG(value);
+  memcpy(&mem->ram[address], &value, sizeof(value));
+  if (address < MEM_GUARD) {
+    memcpy(&mem->ram[MEM_MAX], &mem->ram[0], MEM_GUARD);
+  } else if (address > MEM_MAX - sizeof(value)) {
+    memcpy(&mem->ram[0], &mem->ram[MEM_MAX], MEM_GUARD); /* Wrapped. */
+  }
+  mem->write_n++;
+}
+
+
+
 #endif /* _MEM_H */
@@ -3,6 +3,7 @@
 
 #include <stdarg.h>
 
-void panic(const char *format, ...);
+/* Context is the one given to the subsystem reporting the problem. */
+void panic(void *context, const char *format, ...);
 
 #endif /* _PANIC_H */
@@ -1,12 +1,183 @@
 #include "ramdisk.h"
+#include <fcntl.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "mem.h"
 #include "panic.h"
 
 
 
+/* Indicates no files, shared by all instances. */
+static const uint8_t ramdisk_empty[RAMDISK_TRACK_SIZE] = {
+  [0 ... RAMDISK_TRACK_SIZE - 1] = 0xE5
+};
+
+
+
+/* Space past the loaded image is only filled on first touch, so that
+   untouched tracks never get backed by host memory. */
+static void ramdisk_track_fill(ramdisk_t *ramdisk, uint8_t disk_no,
+  uint16_t track_no)
+{
+  size_t start;
+
+  start = track_no * RAMDISK_TRACK_SIZE;
+  if (ramdisk->loaded[disk_no] > start) {
+    memset(&ramdisk->data[disk_no][ramdisk->loaded[disk_no]], 0xE5,
+      start + RAMDISK_TRACK_SIZE - ramdisk->loaded[disk_no]);
+  } else {
+    memset(&ramdisk->data[disk_no][start], 0xE5, RAMDISK_TRACK_SIZE);
+  }
+  ramdisk->ready[disk_no][track_no] = true;
+}
+
+
+
+static inline void ramdisk_track_touch(ramdisk_t *ramdisk, uint8_t disk_no,
+  uint16_t track_no)
+{
+  if (! ramdisk->ready[disk_no][track_no]) {
+    ramdisk_track_fill(ramdisk, disk_no, track_no);
+  }
+}
+
+
+
+static void ramdisk_dirty_clear(ramdisk_t *ramdisk, uint8_t disk_no)
+{
+  memset(ramdisk->dirty[disk_no], 0, sizeof(ramdisk->dirty[disk_no]));
+  ramdisk->dirty_n[disk_no] = 0;
+}
+
+
+
+static void ramdisk_unload(ramdisk_t *ramdisk, uint8_t disk_no)
+{
+  int i;
+
+  ramdisk->loaded[disk_no] = 0;
+  for (i = 0; i < RAMDISK_TRACKS; i++) {
+    ramdisk->ready[disk_no][i] = false;
+  }
+  ramdisk_dirty_clear(ramdisk, disk_no);
+}
+
+
+
+static inline bool ramdisk_sector_dirty(ramdisk_t *ramdisk, uint8_t disk_no,
+  uint32_t sector)
+{
+  return (ramdisk->dirty[disk_no][sector / 32] >> (sector % 32)) & 1;
+}
+
+
+
+static int ramdisk_pwrite(int fd, const uint8_t *data, size_t n, off_t offset)
+{
+  ssize_t result;
+
+  while (n > 0) {
+    result = pwrite(fd, data, n, offset);
+    if (result < 0) {
+      return -1;
+    }
+    data += result;
+    n -= result;
+    offset += result;
+  }
+  return 0;
+}
+
+
+
+static void ramdisk_image_set(ramdisk_t *ramdisk, uint8_t disk_no,
+  const struct stat *st)
+{
+  ramdisk->image_size[disk_no] = st->st_size;
+  ramdisk->image_mtime[disk_no] = st->st_mtim;
+}
+
+
+
+static bool ramdisk_image_changed(ramdisk_t *ramdisk, uint8_t disk_no,
+  const struct stat *st)
+{
+  return st->st_size != ramdisk->image_size[disk_no] ||
+    st->st_mtim.tv_sec != ramdisk->image_mtime[disk_no].tv_sec ||
+    st->st_mtim.tv_nsec != ramdisk->image_mtime[disk_no].tv_nsec;
+}
+
+
+
+/* Write the disk contents from offset 'start' up to the end. */
+static int ramdisk_save_full(ramdisk_t *ramdisk, uint8_t disk_no, int fd,
+  size_t start)
+{
+  int i;
+  size_t offset;
+  size_t n;
+
+  for (i = start / RAMDISK_TRACK_SIZE; i < RAMDISK_TRACKS; i++) {
+    offset = i * RAMDISK_TRACK_SIZE;
+    if (ramdisk->ready[disk_no][i]) {
+      n = RAMDISK_TRACK_SIZE;
+    } else if (ramdisk->loaded[disk_no] > offset) {
+      n = ramdisk->loaded[disk_no] - offset;
+    } else {
+      n = 0;
+    }
+    if (ramdisk_pwrite(fd, &ramdisk->data[disk_no][offset], n, offset) != 0) {
+      return -1;
+    }
+    if (ramdisk_pwrite(fd, ramdisk_empty, RAMDISK_TRACK_SIZE - n,
+      offset + n) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+
+/* Write only runs of sectors changed since the image was loaded or saved. */
+static int ramdisk_save_dirty(ramdisk_t *ramdisk, uint8_t disk_no, int fd)
+{
+  uint32_t sector;
+  uint32_t start;
+
+  sector = 0;
+  while (sector < RAMDISK_SECTORS_TOTAL) {
+    if (ramdisk->dirty[disk_no][sector / 32] == 0) {
+      sector += 32;
+      continue;
+    }
+    if (! ramdisk_sector_dirty(ramdisk, disk_no, sector)) {
+      sector++;
+      continue;
+    }
+
+    start = sector;
+    while (sector < RAMDISK_SECTORS_TOTAL &&
+      ramdisk_sector_dirty(ramdisk, disk_no, sector)) {
+      sector++;
+    }
+    if (ramdisk_pwrite(fd,
+      &ramdisk->data[disk_no][start * RAMDISK_SECTOR_SIZE],
+      (sector - start) * RAMDISK_SECTOR_SIZE,
+      (off_t)start * RAMDISK_SECTOR_SIZE) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+
+
 uint32_t ramdisk_select(ramdisk_t *ramdisk, uint8_t value)
 {
   if (value >= RAMDISK_MAX) {
@@ -22,7 +193,7 @@ uint32_t ramdisk_select(ramdisk_t *ramdisk, uint8_t value)
 void ramdisk_track_set(ramdisk_t *ramdisk, uint16_t value)
 {
   if (value >= RAMDISK_TRACKS) {
-    panic("RAM disk track out of bounds: %d\n", value);
+    panic(ramdisk->context, "RAM disk track out of bounds: %d\n", value);
   } else {
     ramdisk->track_no = value;
   }
@@ -33,7 +204,7 @@ void ramdisk_track_set(ramdisk_t *ramdisk, uint16_t value)
 void ramdisk_sector_set(ramdisk_t *ramdisk, uint16_t value)
 {
   if (value >= RAMDISK_SECTORS) {
-    panic("RAM disk sector out of bounds: %d\n", value);
+    panic(ramdisk->context, "RAM disk sector out of bounds: %d\n", value);
   } else {
     ramdisk->sector_no = value;
   }
@@ -50,51 +221,73 @@ void ramdisk_dma_set(ramdisk_t *ramdisk, uint32_t value)
 
 void ramdisk_read(ramdisk_t *ramdisk, mem_t *mem)
 {
-  int i;
   uint32_t offset;
 
+  ramdisk_track_touch(ramdisk, ramdisk->disk_no, ramdisk->track_no);
   offset = ((ramdisk->track_no * RAMDISK_SECTORS)
     + ramdisk->sector_no)
     * RAMDISK_SECTOR_SIZE;
-  for (i = 0; i < RAMDISK_SECTOR_SIZE; i++) {
-    mem_write_byte(mem, ramdisk->dma_address + i,
-      ramdisk->data[ramdisk->disk_no][offset + i]);
-  }
+  mem_write_block(mem, ramdisk->dma_address,
+    &ramdisk->data[ramdisk->disk_no][offset], RAMDISK_SECTOR_SIZE);
 }
 
 
 
 void ramdisk_write(ramdisk_t *ramdisk, mem_t *mem)
 {
-  int i;
+  uint32_t sector;
   uint32_t offset;
 
-  offset = ((ramdisk->track_no * RAMDISK_SECTORS)
-    + ramdisk->sector_no)
-    * RAMDISK_SECTOR_SIZE;
-  for (i = 0; i < RAMDISK_SECTOR_SIZE; i++) {
-    ramdisk->data[ramdisk->disk_no][offset + i] =
-      mem_read_byte(mem, ramdisk->dma_address + i);
+  ramdisk_track_touch(ramdisk, ramdisk->disk_no, ramdisk->track_no);
+  sector = (ramdisk->track_no * RAMDISK_SECTORS) + ramdisk->sector_no;
+  if (! ramdisk_sector_dirty(ramdisk, ramdisk->disk_no, sector)) {
+    ramdisk->dirty[ramdisk->disk_no][sector / 32] |= 1U << (sector % 32);
+    ramdisk->dirty_n[ramdisk->disk_no]++;
   }
+  offset = sector * RAMDISK_SECTOR_SIZE;
+  mem_read_block(mem, ramdisk->dma_address,
+    &ramdisk->data[ramdisk->disk_no][offset], RAMDISK_SECTOR_SIZE);
 }
 
 
 
-void ramdisk_init(ramdisk_t *ramdisk)
+int ramdisk_init(ramdisk_t *ramdisk)
 {
   int i;
-  size_t n;
 
   ramdisk->disk_no = 0;
   ramdisk->track_no = 0;
   ramdisk->sector_no = 0;
   ramdisk->dma_address = 0;
+  ramdisk->write_through = false;
+  ramdisk->context = NULL;
 
   for (i = 0; i < RAMDISK_MAX; i++) {
-    for (n = 0; n < RAMDISK_SIZE; n++) {
-      ramdisk->data[i][n] = 0xE5; /* Fill space to indicate no files. */
+    ramdisk->data[i] = mmap(NULL, RAMDISK_SIZE, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ramdisk->data[i] == MAP_FAILED) {
+      ramdisk->data[i] = NULL;
+      return -1;
     }
+    ramdisk_unload(ramdisk, i);
     ramdisk->filename[i][0] = '\0';
+    ramdisk->synced[i] = false;
+  }
+
+  return 0;
+}
+
+
+
+void ramdisk_free(ramdisk_t *ramdisk)
+{
+  int i;
+
+  for (i = 0; i < RAMDISK_MAX; i++) {
+    if (ramdisk->data[i] != NULL) {
+      munmap(ramdisk->data[i], RAMDISK_SIZE);
+      ramdisk->data[i] = NULL;
+    }
   }
 }
 
@@ -102,11 +295,13 @@ void ramdisk_init(ramdisk_t *ramdisk)
 
 int ramdisk_load(ramdisk_t *ramdisk, uint8_t disk_no, const char *filename)
 {
-  FILE *fh;
-  size_t n;
-  int c;
+  struct stat st;
+  size_t size;
+  void *data;
+  int fd;
+  int i;
 
-  if (disk_no > RAMDISK_MAX) {
+  if (disk_no >= RAMDISK_MAX) {
     return -2;
   }
 
@@ -114,21 +309,67 @@ int ramdisk_load(ramdisk_t *ramdisk, uint8_t disk_no, const char *filename)
     return -3;
   }
 
-  fh = fopen(filename, "rb");
-  if (fh == NULL) {
+  fd = open(filename, ramdisk->write_through ? O_RDWR : O_RDONLY);
+  if (fd == -1) {
+    return -1;
+  }
+
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return -1;
+  }
+  ramdisk_image_set(ramdisk, disk_no, &st);
+  size = st.st_size;
+  if (size > RAMDISK_SIZE) {
+    size = RAMDISK_SIZE;
+  }
+
+  /* Write-through needs the whole disk in the image, grow it once. */
+  if (ramdisk->write_through && size < RAMDISK_SIZE) {
+    if (ftruncate(fd, RAMDISK_SIZE) != 0) {
+      close(fd);
+      return -1;
+    }
+  }
+
+  /* Start over with anonymous memory in case the disk was loaded before. */
+  data = mmap(ramdisk->data[disk_no], RAMDISK_SIZE, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+  if (data == MAP_FAILED) {
+    close(fd);
+    return -1;
+  }
+  ramdisk_unload(ramdisk, disk_no);
+
+  if (ramdisk->write_through) {
+    data = mmap(ramdisk->data[disk_no], RAMDISK_SIZE, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_FIXED, fd, 0);
+  } else if (size > 0) {
+    data = mmap(ramdisk->data[disk_no], size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_FIXED, fd, 0);
+  }
+  close(fd); /* Mapping keeps a reference to the file. */
+  if (data == MAP_FAILED) {
     return -1;
   }
 
-  for (n = 0; n < RAMDISK_SIZE; n++) {
-    c = fgetc(fh);
-    if (c == EOF) {
-      break;
+  ramdisk->loaded[disk_no] = size;
+  for (i = 0; i < RAMDISK_TRACKS; i++) {
+    if ((size_t)(i + 1) * RAMDISK_TRACK_SIZE <= size) {
+      ramdisk->ready[disk_no][i] = true;
+    }
+  }
+
+  if (ramdisk->write_through) {
+    /* Fill the grown part now, since it persists across sessions. */
+    for (i = 0; i < RAMDISK_TRACKS; i++) {
+      ramdisk_track_touch(ramdisk, disk_no, i);
     }
-    ramdisk->data[disk_no][n] = c;
+    ramdisk->loaded[disk_no] = RAMDISK_SIZE;
   }
 
-  fclose(fh);
   strncpy(ramdisk->filename[disk_no], filename, PATH_MAX);
+  ramdisk->synced[disk_no] = true;
   return 0;
 }
 
@@ -136,10 +377,11 @@ int ramdisk_load(ramdisk_t *ramdisk, uint8_t disk_no, const char *filename)
 
 int ramdisk_save(ramdisk_t *ramdisk, uint8_t disk_no, const char *filename)
 {
-  FILE *fh;
-  size_t n;
+  struct stat st;
+  int fd;
+  int result;
 
-  if (disk_no > RAMDISK_MAX) {
+  if (disk_no >= RAMDISK_MAX) {
     return -2;
   }
 
@@ -147,26 +389,205 @@ int ramdisk_save(ramdisk_t *ramdisk, uint8_t disk_no, const char *filename)
     if (ramdisk->filename[disk_no][0] == '\0') {
       return -3;
     }
-    fh = fopen(ramdisk->filename[disk_no], "wb");
-  } else {
-    fh = fopen(filename, "wb");
+    if (ramdisk->write_through) {
+      /* Image is already up to date, just make sure it is on disk. */
+      if (msync(ramdisk->data[disk_no], RAMDISK_SIZE, MS_SYNC) != 0) {
+        return -1;
+      }
+      ramdisk_dirty_clear(ramdisk, disk_no);
+      return 0;
+    }
+    filename = ramdisk->filename[disk_no];
   }
 
-  if (fh == NULL) {
+  /* Do not truncate, the image may be mapped and still backing the disk. */
+  fd = open(filename, O_WRONLY | O_CREAT, 0666);
+  if (fd == -1) {
+    return -1;
+  }
+  if (fstat(fd, &st) != 0) {
+    close(fd);
     return -1;
   }
 
-  for (n = 0; n < RAMDISK_SIZE; n++) {
-    fputc(ramdisk->data[disk_no][n], fh);
+  if (filename == ramdisk->filename[disk_no] && ramdisk->synced[disk_no]) {
+    /* Pages not yet copied still read from the image, so a change made
+       by someone else may already have mixed in. Do not save over it. */
+    if (ramdisk_image_changed(ramdisk, disk_no, &st)) {
+      close(fd);
+      return -4;
+    }
+    /* Own image only differs in dirty sectors, and any missing tail. */
+    result = ramdisk_save_dirty(ramdisk, disk_no, fd);
+    if (result == 0 && (size_t)st.st_size < RAMDISK_SIZE) {
+      result = ramdisk_save_full(ramdisk, disk_no, fd,
+        st.st_size - (st.st_size % RAMDISK_TRACK_SIZE));
+    }
+  } else {
+    /* Another image, or the own one after a snapshot was restored. */
+    result = ramdisk_save_full(ramdisk, disk_no, fd, 0);
+  }
+
+  if (result == 0 && st.st_size > RAMDISK_SIZE) {
+    result = ftruncate(fd, RAMDISK_SIZE);
+  }
+  if (result == 0) {
+    result = fstat(fd, &st);
+  }
+  if (close(fd) != 0 || result != 0) {
+    return -1;
   }
-  fclose(fh);
 
-  if (filename != NULL) {
+  /* A write-through disk stays mapped to its image, so keep that name. */
+  if (filename != ramdisk->filename[disk_no] && ! ramdisk->write_through) {
     strncpy(ramdisk->filename[disk_no], filename, PATH_MAX);
   }
+  if (! ramdisk->write_through) {
+    ramdisk_image_set(ramdisk, disk_no, &st);
+    ramdisk_dirty_clear(ramdisk, disk_no);
+    ramdisk->synced[disk_no] = true;
+  }
+
+  return 0;
+}
+
+
+
+bool ramdisk_dirty(ramdisk_t *ramdisk, uint8_t disk_no)
+{
+  return ramdisk->dirty_n[disk_no] > 0;
+}
+
+
+
+/* Bytes of a track that hold data, the rest is filled in on first use. */
+static size_t ramdisk_track_used(ramdisk_t *ramdisk, uint8_t disk_no,
+  uint16_t track_no)
+{
+  size_t offset = track_no * RAMDISK_TRACK_SIZE;
+
+  if (ramdisk->ready[disk_no][track_no]) {
+    return RAMDISK_TRACK_SIZE;
+  } else if (ramdisk->loaded[disk_no] > offset) {
+    return ramdisk->loaded[disk_no] - offset;
+  } else {
+    return 0;
+  }
+}
+
+
+
+int ramdisk_snapshot_save(ramdisk_t *ramdisk, FILE *fh)
+{
+  int i;
+  int j;
+  size_t n;
+
+  for (i = 0; i < RAMDISK_MAX; i++) {
+    if (fwrite(ramdisk->filename[i], PATH_MAX, 1, fh) != 1 ||
+      fwrite(&ramdisk->loaded[i], sizeof(size_t), 1, fh) != 1 ||
+      fwrite(ramdisk->ready[i], sizeof(ramdisk->ready[i]), 1, fh) != 1 ||
+      fwrite(ramdisk->dirty[i], sizeof(ramdisk->dirty[i]), 1, fh) != 1 ||
+      fwrite(&ramdisk->dirty_n[i], sizeof(uint32_t), 1, fh) != 1) {
+      return -1;
+    }
+
+    /* Untouched space past the image is not stored. */
+    for (j = 0; j < RAMDISK_TRACKS; j++) {
+      n = ramdisk_track_used(ramdisk, i, j);
+      if (n > 0 && fwrite(&ramdisk->data[i][j * RAMDISK_TRACK_SIZE],
+        n, 1, fh) != 1) {
+        return -1;
+      }
+    }
+  }
+
+  if (fwrite(&ramdisk->disk_no, sizeof(uint8_t), 1, fh) != 1 ||
+    fwrite(&ramdisk->track_no, sizeof(uint16_t), 1, fh) != 1 ||
+    fwrite(&ramdisk->sector_no, sizeof(uint16_t), 1, fh) != 1 ||
+    fwrite(&ramdisk->dma_address, sizeof(uint32_t), 1, fh) != 1) {
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* Restores into a RAM disk fresh from ramdisk_init(), so that nothing in
+   use is changed until all of the snapshot has been read. */
+int ramdisk_snapshot_load(ramdisk_t *ramdisk, FILE *fh)
+{
+  int i;
+  int j;
+  size_t n;
+
+  for (i = 0; i < RAMDISK_MAX; i++) {
+    if (fread(ramdisk->filename[i], PATH_MAX, 1, fh) != 1 ||
+      fread(&ramdisk->loaded[i], sizeof(size_t), 1, fh) != 1 ||
+      fread(ramdisk->ready[i], sizeof(ramdisk->ready[i]), 1, fh) != 1 ||
+      fread(ramdisk->dirty[i], sizeof(ramdisk->dirty[i]), 1, fh) != 1 ||
+      fread(&ramdisk->dirty_n[i], sizeof(uint32_t), 1, fh) != 1) {
+      return -1;
+    }
+    ramdisk->filename[i][PATH_MAX - 1] = '\0';
+    if (ramdisk->loaded[i] > RAMDISK_SIZE) {
+      return -2;
+    }
+
+    for (j = 0; j < RAMDISK_TRACKS; j++) {
+      n = ramdisk_track_used(ramdisk, i, j);
+      if (n > 0 && fread(&ramdisk->data[i][j * RAMDISK_TRACK_SIZE],
+        n, 1, fh) != 1) {
+        return -1;
+      }
+    }
+  }
+
+  if (fread(&ramdisk->disk_no, sizeof(uint8_t), 1, fh) != 1 ||
+    fread(&ramdisk->track_no, sizeof(uint16_t), 1, fh) != 1 ||
+    fread(&ramdisk->sector_no, sizeof(uint16_t), 1, fh) != 1 ||
+    fread(&ramdisk->dma_address, sizeof(uint32_t), 1, fh) != 1) {
+    return -1;
+  }
+  if (ramdisk->disk_no >= RAMDISK_MAX ||
+    ramdisk->track_no >= RAMDISK_TRACKS ||
+    ramdisk->sector_no >= RAMDISK_SECTORS) {
+    return -2;
+  }
 
   return 0;
 }
 
 
 
+/* Swap in the disks restored by ramdisk_snapshot_load(), the old ones end
+   up in 'restored' to be freed. Settings of this session are kept. */
+void ramdisk_snapshot_take(ramdisk_t *ramdisk, ramdisk_t *restored)
+{
+  uint8_t *data;
+  int i;
+
+  for (i = 0; i < RAMDISK_MAX; i++) {
+    data = ramdisk->data[i];
+    ramdisk->data[i] = restored->data[i];
+    restored->data[i] = data;
+
+    memcpy(ramdisk->filename[i], restored->filename[i], PATH_MAX);
+    ramdisk->loaded[i] = restored->loaded[i];
+    memcpy(ramdisk->ready[i], restored->ready[i], sizeof(ramdisk->ready[i]));
+    memcpy(ramdisk->dirty[i], restored->dirty[i], sizeof(ramdisk->dirty[i]));
+    ramdisk->dirty_n[i] = restored->dirty_n[i];
+
+    /* Not mapped from the image, which may hold anything by now. */
+    ramdisk->synced[i] = false;
+  }
+
+  ramdisk->disk_no = restored->disk_no;
+  ramdisk->track_no = restored->track_no;
+  ramdisk->sector_no = restored->sector_no;
+  ramdisk->dma_address = restored->dma_address;
+}
+
+
+
@@ -2,22 +2,38 @@
 #define _RAMDISK_H
 
 #include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <time.h>
 #include "mem.h"
 
 #define RAMDISK_MAX 4
 #define RAMDISK_TRACKS 512
 #define RAMDISK_SECTORS 256 /* Per Track */
 #define RAMDISK_SECTOR_SIZE 128
-#define RAMDISK_SIZE (RAMDISK_TRACKS * RAMDISK_SECTORS * RAMDISK_SECTOR_SIZE)
+#define RAMDISK_TRACK_SIZE (RAMDISK_SECTORS * RAMDISK_SECTOR_SIZE)
+#define RAMDISK_SIZE (RAMDISK_TRACKS * RAMDISK_TRACK_SIZE)
+#define RAMDISK_SECTORS_TOTAL (RAMDISK_TRACKS * RAMDISK_SECTORS)
 
 typedef struct ramdisk_s {
   char filename[RAMDISK_MAX][PATH_MAX];
-  uint8_t data[RAMDISK_MAX][RAMDISK_SIZE];
+  uint8_t *data[RAMDISK_MAX]; /* Mapped, backed by image up to 'loaded'. */
+  size_t loaded[RAMDISK_MAX];
+  bool ready[RAMDISK_MAX][RAMDISK_TRACKS]; /* Space past image filled. */
+  bool write_through; /* Map images shared instead of copy-on-write. */
+  uint32_t dirty[RAMDISK_MAX][RAMDISK_SECTORS_TOTAL / 32]; /* Unsaved. */
+  uint32_t dirty_n[RAMDISK_MAX];
+  bool synced[RAMDISK_MAX]; /* Image only differs in dirty sectors. */
+  off_t image_size[RAMDISK_MAX]; /* Image as last loaded or saved, to */
+  struct timespec image_mtime[RAMDISK_MAX]; /* notice outside changes. */
   uint8_t disk_no;
   uint16_t track_no;
   uint16_t sector_no;
   uint32_t dma_address;
+  void *context; /* Passed to panic(). */
 } ramdisk_t;
 
 uint32_t ramdisk_select(ramdisk_t *ramdisk, uint8_t value);
@@ -26,8 +42,13 @@ void ramdisk_sector_set(ramdisk_t *ramdisk, uint16_t value);
 void ramdisk_dma_set(ramdisk_t *ramdisk, uint32_t value);
 void ramdisk_read(ramdisk_t *ramdisk, mem_t *mem);
 void ramdisk_write(ramdisk_t *ramdisk, mem_t *mem);
-void ramdisk_init(ramdisk_t *ramdisk);
+int ramdisk_init(ramdisk_t *ramdisk);
+void ramdisk_free(ramdisk_t *ramdisk);
 int ramdisk_load(ramdisk_t *ramdisk, uint8_t disk_no, const char *filename);
 int ramdisk_save(ramdisk_t *ramdisk, uint8_t disk_no, const char *filename);
+bool ramdisk_dirty(ramdisk_t *ramdisk, uint8_t disk_no);
+int ramdisk_snapshot_save(ramdisk_t *ramdisk, FILE *fh);
+int ramdisk_snapshot_load(ramdisk_t *ramdisk, FILE *fh);
+void ramdisk_snapshot_take(ramdisk_t *ramdisk, ramdisk_t *restored);
 
 #endif /* _RAMDISK_H */
@@ -0,0 +1,145 @@
+#include "server.h"
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "console.h"
+
+
+
+#define SERVER_BACKLOG 16
+
+static int server_fd = -1;
+static pid_t server_pid = -1;
+static char server_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+
+
+static void server_exit(void)
+{
+  /* Forked jobs inherit this, but the socket belongs to the server. */
+  if (getpid() == server_pid) {
+    close(server_fd);
+    unlink(server_path);
+  }
+}
+
+
+
+static int server_listen(const char *path)
+{
+  struct sockaddr_un addr;
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    return -2;
+  }
+
+  server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server_fd == -1) {
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(struct sockaddr_un));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  unlink(path); /* Stale socket from an earlier run. */
+
+  if (bind(server_fd, (struct sockaddr *)&addr,
+    sizeof(struct sockaddr_un)) != 0 ||
+    listen(server_fd, SERVER_BACKLOG) != 0) {
+    close(server_fd);
+    server_fd = -1;
+    return -1;
+  }
+
+  strncpy(server_path, path, sizeof(server_path) - 1);
+  server_pid = getpid();
+  atexit(server_exit);
+  signal(SIGCHLD, SIG_IGN); /* Jobs are reaped automatically. */
+  return 0;
+}
+
+
+
+/* The job is everything the client sends before shutting down its side,
+   read from the connection as CP/M takes it. */
+static int server_job_setup(int fd, console_t *console)
+{
+  int input_fd;
+  int pipe_fd[2];
+
+  input_fd = dup(fd);
+  if (input_fd == -1 || console_inject_fd(console, input_fd) != 0) {
+    return -1;
+  }
+
+  /* Input only comes from the job, so stdin is a pipe that never becomes
+     readable. The write end stays open until the job exits. */
+  if (pipe(pipe_fd) != 0) {
+    return -1;
+  }
+  if (dup2(pipe_fd[0], STDIN_FILENO) == -1 ||
+    dup2(fd, STDOUT_FILENO) == -1) {
+    return -1;
+  }
+  close(pipe_fd[0]);
+  close(fd); /* Output goes back to the client through stdout. */
+  return 0;
+}
+
+
+
+/* Wait for job connections and fork a copy of the emulator for each. Returns
+   0 in the forked job, 1 in the server if interrupted by a signal. */
+int server_accept(const char *path, console_t *console)
+{
+  struct pollfd fds[1];
+  int fd;
+  pid_t pid;
+
+  if (server_fd == -1) {
+    if (server_listen(path) != 0) {
+      return -1;
+    }
+  }
+
+  while (1) {
+    fds[0].fd = server_fd;
+    fds[0].events = POLLIN;
+    if (poll(fds, 1, -1) == -1) {
+      if (errno == EINTR) {
+        return 1;
+      }
+      return -1;
+    }
+
+    fd = accept(server_fd, NULL, NULL);
+    if (fd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return -1;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+      close(server_fd);
+      server_fd = -1;
+      if (server_job_setup(fd, console) != 0) {
+        _exit(EXIT_FAILURE);
+      }
+      return 0;
+    }
+
+    close(fd); /* Parent keeps serving, also if fork() failed. */
+  }
+}
+
+
+
@@ -0,0 +1,8 @@
+#ifndef _SERVER_H
+#define _SERVER_H
+
+#include "console.h"
+
+int server_accept(const char *path, console_t *console);
+
+#endif /* _SERVER_H */
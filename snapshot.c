@@ -0,0 +1,176 @@
+#include "snapshot.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "console.h"
+#include "emu.h"
+#include "m68k.h"
+#include "mem.h"
+#include "ramdisk.h"
+
+
+
+#define SNAPSHOT_MEM_CHUNK 0x10000
+
+/* Snapshots are only meant to be restored by the same build and host,
+   the layout check catches the obvious mismatches. */
+typedef struct snapshot_header_s {
+  char magic[SNAPSHOT_FILE_MAGIC_SIZE];
+  uint32_t mem_size;
+  uint32_t ramdisk_max;
+  uint32_t ramdisk_size;
+  uint32_t path_max;
+} snapshot_header_t;
+
+typedef struct snapshot_cpu_s {
+  uint32_t pc;
+  uint32_t d[8];
+  uint32_t a[8];
+  uint32_t ssp;
+  uint16_t sr;
+} snapshot_cpu_t;
+
+
+
+static void snapshot_header_init(snapshot_header_t *header)
+{
+  memset(header, 0, sizeof(snapshot_header_t));
+  memcpy(header->magic, SNAPSHOT_FILE_MAGIC, SNAPSHOT_FILE_MAGIC_SIZE);
+  header->mem_size = MEM_MAX;
+  header->ramdisk_max = RAMDISK_MAX;
+  header->ramdisk_size = RAMDISK_SIZE;
+  header->path_max = PATH_MAX;
+}
+
+
+
+int snapshot_save(const char *filename, emu_t *emu)
+{
+  m68k_t *cpu = &emu->cpu;
+  FILE *fh;
+  snapshot_header_t header;
+  snapshot_cpu_t state;
+  uint8_t *chunk;
+  uint32_t address;
+  int result;
+
+  chunk = malloc(SNAPSHOT_MEM_CHUNK);
+  if (chunk == NULL) {
+    return -1;
+  }
+
+  fh = fopen(filename, "wb");
+  if (fh == NULL) {
+    free(chunk);
+    return -1;
+  }
+
+  snapshot_header_init(&header);
+
+  m68k_cc_flush(cpu);
+  memset(&state, 0, sizeof(snapshot_cpu_t));
+  state.pc = cpu->pc;
+  memcpy(state.d, cpu->d, sizeof(state.d));
+  memcpy(state.a, cpu->a, sizeof(state.a));
+  state.ssp = cpu->ssp;
+  state.sr = cpu->sr;
+
+  result = 0;
+  if (fwrite(&header, sizeof(snapshot_header_t), 1, fh) != 1 ||
+    fwrite(&state, sizeof(snapshot_cpu_t), 1, fh) != 1) {
+    result = -2;
+  }
+
+  /* Through mem_read_block() so memory is saved in guest byte order,
+     whatever the layout of this build. */
+  for (address = 0; result == 0 && address < MEM_MAX;
+    address += SNAPSHOT_MEM_CHUNK) {
+    mem_read_block(&emu->mem, address, chunk, SNAPSHOT_MEM_CHUNK);
+    if (fwrite(chunk, SNAPSHOT_MEM_CHUNK, 1, fh) != 1) {
+      result = -2;
+    }
+  }
+  free(chunk);
+
+  if (result == 0 && (ramdisk_snapshot_save(&emu->ramdisk, fh) != 0 ||
+    console_snapshot_save(&emu->console, fh) != 0)) {
+    result = -2;
+  }
+
+  if (fclose(fh) != 0) {
+    return -2;
+  }
+  return result;
+}
+
+
+
+int snapshot_load(const char *filename, emu_t *emu)
+{
+  m68k_t *cpu = &emu->cpu;
+  FILE *fh;
+  snapshot_header_t header;
+  snapshot_header_t expected;
+  snapshot_cpu_t state;
+  uint8_t *ram;
+  ramdisk_t *restored;
+  int result;
+
+  /* Restored disks are not backed by their images. */
+  if (emu->ramdisk.write_through) {
+    return -4;
+  }
+
+  fh = fopen(filename, "rb");
+  if (fh == NULL) {
+    return -1;
+  }
+
+  snapshot_header_init(&expected);
+  if (fread(&header, sizeof(snapshot_header_t), 1, fh) != 1 ||
+    memcmp(&header, &expected, sizeof(snapshot_header_t)) != 0) {
+    fclose(fh);
+    return -3;
+  }
+
+  /* Everything is read before anything is changed, so a short or broken
+     snapshot leaves the machine as it was. The console goes last and is
+     only changed once all of its part has been read. */
+  result = 0;
+  ram = malloc(MEM_MAX);
+  restored = calloc(1, sizeof(ramdisk_t));
+  if (ram == NULL || restored == NULL || ramdisk_init(restored) != 0) {
+    result = -1;
+  } else if (fread(&state, sizeof(snapshot_cpu_t), 1, fh) != 1 ||
+    fread(ram, MEM_MAX, 1, fh) != 1 ||
+    ramdisk_snapshot_load(restored, fh) != 0 ||
+    console_snapshot_load(&emu->console, fh) != 0) {
+    result = -2;
+  }
+  fclose(fh);
+
+  if (result == 0) {
+    /* Through mem_write_block() so cached blocks are invalidated. */
+    mem_write_block(&emu->mem, 0, ram, MEM_MAX);
+    ramdisk_snapshot_take(&emu->ramdisk, restored);
+
+    /* Hooks, breakpoint and trace settings belong to this session. */
+    cpu->pc = state.pc;
+    memcpy(cpu->d, state.d, sizeof(state.d));
+    memcpy(cpu->a, state.a, sizeof(state.a));
+    cpu->ssp = state.ssp;
+    cpu->sr = state.sr;
+    cpu->cc_op = M68K_CC_NONE;
+  }
+
+  free(ram);
+  if (restored != NULL) {
+    ramdisk_free(restored); /* Old disks after a take. */
+    free(restored);
+  }
+  return result;
+}
+
+
+
@@ -0,0 +1,12 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include "emu.h"
+
+#define SNAPSHOT_FILE_MAGIC "CPM68SN2"
+#define SNAPSHOT_FILE_MAGIC_SIZE 8
+
+int snapshot_save(const char *filename, emu_t *emu);
+int snapshot_load(const char *filename, emu_t *emu);
+
+#endif /* _SNAPSHOT_H */
@@ -0,0 +1,153 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "m68k_disasm.h"
+#include "m68k_trace.h"
+
+
+
+#define TRACEDUMP_READ_SIZE 4096 /* Records read at a time. */
+
+
+
+static void display_help(const char *progname)
+{
+  fprintf(stdout, "Usage: %s <options> trace-file\n", progname);
+  fprintf(stdout, "Options:\n"
+    "  -h        Display this help.\n"
+    "  -s ADDR   Only show instructions at or above (hex) ADDR.\n"
+    "  -e ADDR   Only show instructions at or below (hex) ADDR.\n"
+    "  -m STR    Only show instructions with mnemonic STR, e.g. 'JSR'.\n"
+    "\n");
+  fprintf(stdout,
+    "Decodes binary trace files written by 'cpm68emu -T FILE'.\n\n");
+}
+
+
+
+/* Match "MOVE" against both "MOVE.L" and "MOVE", but not "MOVEQ". */
+static bool mnemonic_match(const char *mnemonic, const char *filter)
+{
+  size_t len = strlen(filter);
+
+  if (len == 0) {
+    return true;
+  }
+  if (strncasecmp(mnemonic, filter, len) != 0) {
+    return false;
+  }
+  return mnemonic[len] == '\0' || mnemonic[len] == '.' ||
+    filter[len - 1] == '.';
+}
+
+
+
+static void record_print(FILE *fh, m68k_trace_record_t *record,
+  m68k_disasm_t *disasm)
+{
+  int i;
+
+  fprintf(fh, "%06x   ", record->pc);
+
+  for (i = 0; i < record->mc_n; i++) {
+    fprintf(fh, "%04x ", record->mc[i]);
+  }
+  for (; i < 6; i++) {
+    fprintf(fh, "     ");
+  }
+
+  if (disasm->dst[0] == '\0' && disasm->src[0] == '\0') {
+    fprintf(fh, "%s\n", disasm->mnemonic);
+  } else if (disasm->src[0] == '\0') {
+    fprintf(fh, "%s %s\n", disasm->mnemonic, disasm->dst);
+  } else if (disasm->dst[0] == '\0') {
+    fprintf(fh, "%s %s\n", disasm->mnemonic, disasm->src);
+  } else {
+    fprintf(fh, "%s %s, %s\n",
+      disasm->mnemonic, disasm->src, disasm->dst);
+  }
+}
+
+
+
+int main(int argc, char *argv[])
+{
+  int c;
+  size_t i;
+  size_t n;
+  FILE *fh;
+  char magic[M68K_TRACE_FILE_MAGIC_SIZE];
+  static m68k_trace_record_t record[TRACEDUMP_READ_SIZE];
+  m68k_disasm_t disasm;
+  unsigned int pc_start = 0;
+  unsigned int pc_end = 0xFFFFFF;
+  char *mnemonic = NULL;
+
+  while ((c = getopt(argc, argv, "hs:e:m:")) != -1) {
+    switch (c) {
+    case 'h':
+      display_help(argv[0]);
+      return EXIT_SUCCESS;
+
+    case 's':
+      sscanf(optarg, "%x", &pc_start);
+      break;
+
+    case 'e':
+      sscanf(optarg, "%x", &pc_end);
+      break;
+
+    case 'm':
+      mnemonic = optarg;
+      break;
+
+    case '?':
+    default:
+      display_help(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (argc <= optind) {
+    display_help(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  fh = fopen(argv[optind], "rb");
+  if (fh == NULL) {
+    fprintf(stdout, "Opening trace file '%s' failed!\n", argv[optind]);
+    return EXIT_FAILURE;
+  }
+
+  if (fread(magic, 1, M68K_TRACE_FILE_MAGIC_SIZE, fh) !=
+    M68K_TRACE_FILE_MAGIC_SIZE ||
+    memcmp(magic, M68K_TRACE_FILE_MAGIC, M68K_TRACE_FILE_MAGIC_SIZE) != 0) {
+    fprintf(stdout, "File '%s' is not a trace file!\n", argv[optind]);
+    fclose(fh);
+    return EXIT_FAILURE;
+  }
+
+  while ((n = fread(record, sizeof(m68k_trace_record_t),
+    TRACEDUMP_READ_SIZE, fh)) > 0) {
+    for (i = 0; i < n; i++) {
+      if (record[i].pc < pc_start || record[i].pc > pc_end) {
+        continue;
+      }
+      m68k_disasm(&disasm, record[i].pc, record[i].mc, record[i].mc_n);
+      if (mnemonic != NULL && ! mnemonic_match(disasm.mnemonic, mnemonic)) {
+        continue;
+      }
+      record_print(stdout, &record[i], &disasm);
+    }
+  }
+
+  fclose(fh);
+  return EXIT_SUCCESS;
+}
+
+
+